@@ -12,6 +12,7 @@
 #define FSBegin() true
 #define FILE_O_WRITE "w"
 #define FILE_O_READ "r"
+#define FILE_O_APPEND "a"
 #endif
 
 #if defined(ARCH_STM32WL)
@@ -19,6 +20,7 @@
 #define FSCom InternalFS
 #define FSBegin() FSCom.begin()
 using namespace LittleFS_Namespace;
+#define FILE_O_APPEND FILE_O_WRITE // Adafruit style LittleFS always opens for writing at the end of the file
 #endif
 
 #if defined(ARCH_RP2040)
@@ -28,6 +30,7 @@ using namespace LittleFS_Namespace;
 #define FSBegin() FSCom.begin() // set autoformat
 #define FILE_O_WRITE "w"
 #define FILE_O_READ "r"
+#define FILE_O_APPEND "a"
 #endif
 
 #if defined(ARCH_ESP32)
@@ -37,6 +40,7 @@ using namespace LittleFS_Namespace;
 #define FSBegin() FSCom.begin(true) // format on failure
 #define FILE_O_WRITE "w"
 #define FILE_O_READ "r"
+#define FILE_O_APPEND "a"
 #endif
 
 #if defined(ARCH_NRF52)
@@ -45,6 +49,7 @@ using namespace LittleFS_Namespace;
 #define FSCom InternalFS
 #define FSBegin() FSCom.begin() // InternalFS formats on failure
 using namespace Adafruit_LittleFS_Namespace;
+#define FILE_O_APPEND FILE_O_WRITE // Adafruit LittleFS always opens for writing at the end of the file
 #endif
 
 void fsInit();
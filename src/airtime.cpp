@@ -31,6 +31,14 @@ void AirTime::logAirtime(reportTypes reportType, uint32_t airtime_ms)
     this->channelUtilization[this->getPeriodUtilMinute()] = channelUtilization[this->getPeriodUtilMinute()] + airtime_ms;
 }
 
+void AirTime::logAirtimeSaved(uint32_t airtime_ms)
+{
+    airtimeSavedMsec += airtime_ms;
+    numRebroadcastsSaved++;
+    LOG_DEBUG("AirTime - Rebroadcast suppressed : %ums (%u rebroadcasts, %ums saved in total)\n", airtime_ms,
+              numRebroadcastsSaved, airtimeSavedMsec);
+}
+
 uint8_t AirTime::currentPeriodIndex()
 {
     return ((getSecondsSinceBoot() / SECONDS_PER_PERIOD) % PERIODS_TO_LOG);
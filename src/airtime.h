@@ -46,6 +46,12 @@ class AirTime : private concurrency::OSThread
     AirTime();
 
     void logAirtime(reportTypes reportType, uint32_t airtime_ms);
+
+    /// We dropped a queued rebroadcast that would have taken airtime_ms, because others had already covered it
+    void logAirtimeSaved(uint32_t airtime_ms);
+    uint32_t getAirtimeSavedMsec() { return airtimeSavedMsec; }
+    uint32_t getNumRebroadcastsSaved() { return numRebroadcastsSaved; }
+
     float channelUtilizationPercent();
     float utilizationTXPercent();
 
@@ -70,6 +76,8 @@ class AirTime : private concurrency::OSThread
     uint8_t max_channel_util_percent = 40;
     uint8_t polite_channel_util_percent = 25;
     uint8_t polite_duty_cycle_percent = 50; // half of Duty Cycle allowance is ok for metadata
+    uint32_t airtimeSavedMsec = 0;
+    uint32_t numRebroadcastsSaved = 0;
 
     struct airtimeStruct {
         uint32_t periodTX[PERIODS_TO_LOG];     // AirTime transmitted
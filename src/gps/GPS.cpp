@@ -41,6 +41,7 @@ struct uBloxGnssModelInfo info;
 uint8_t uBloxProtocolVersion;
 #define GPS_SOL_EXPIRY_MS 5000 // in millis. give 1 second time to combine different sentences. NMEA Frequency isn't higher anyway
 #define NMEA_MSG_GXGSA "GNGSA" // GSA message (GPGSA, GNGSA etc)
+#define GPS_REPLY_BUFFER_SIZE 768 // Big enough for a UBX-MON-VER with all its extensions
 
 // For logging
 const char *getGPSPowerStateString(GPSPowerState state)
@@ -154,636 +155,558 @@ uint8_t GPS::makeCASPacket(uint8_t class_id, uint8_t msg_id, uint8_t payload_siz
     return (payload_size + 10);
 }
 
-GPS_RESPONSE GPS::getACK(const char *message, uint32_t waitMillis)
+/// Feed what the GPS sends to matcher (blocking) until it sees its reply, or waitMillis is up
+GPS_RESPONSE GPS::waitForReply(GPSReplyMatcher &matcher, uint32_t waitMillis)
 {
-    uint8_t buffer[768] = {0};
-    uint8_t b;
-    int bytesRead = 0;
-    uint32_t startTimeout = millis() + waitMillis;
-    while (millis() < startTimeout) {
+    uint32_t startTime = millis();
+    while (millis() - startTime < waitMillis) {
         if (_serial_gps->available()) {
-            b = _serial_gps->read();
-
-#ifdef GPS_DEBUG
-            LOG_DEBUG("%02X", (char *)buffer);
-#endif
-            buffer[bytesRead] = b;
-            bytesRead++;
-            if ((bytesRead == 767) || (b == '\r')) {
-                if (strnstr((char *)buffer, message, bytesRead) != nullptr) {
-#ifdef GPS_DEBUG
-                    LOG_DEBUG("\r");
-#endif
-                    return GNSS_RESPONSE_OK;
-                } else {
-                    bytesRead = 0;
-                }
-            }
+            GPS_RESPONSE response = matcher.feed(_serial_gps->read());
+            if (response != GNSS_RESPONSE_NONE)
+                return response;
         }
     }
-#ifdef GPS_DEBUG
-    LOG_DEBUG("\n");
-#endif
     return GNSS_RESPONSE_NONE;
 }
 
-GPS_RESPONSE GPS::getACKCas(uint8_t class_id, uint8_t msg_id, uint32_t waitMillis)
+GPS_RESPONSE GPS::getACK(const char *message, uint32_t waitMillis)
 {
-    uint32_t startTime = millis();
-    uint8_t buffer[CAS_ACK_NACK_MSG_SIZE] = {0};
-    uint8_t bufferPos = 0;
-
-    // CAS-ACK-(N)ACK structure
-    //         | H1   | H2   | Payload Len | cls  | msg  | Payload                   | Checksum (4)              |
-    //         |      |      |             |      |      | Cls  | Msg  | Reserved    |                           |
-    //         |------|------|-------------|------|------|------|------|-------------|---------------------------|
-    // ACK-NACK| 0xBA | 0xCE | 0x04 | 0x00 | 0x05 | 0x00 | 0xXX | 0xXX | 0x00 | 0x00 | 0xXX | 0xXX | 0xXX | 0xXX |
-    // ACK-ACK | 0xBA | 0xCE | 0x04 | 0x00 | 0x05 | 0x01 | 0xXX | 0xXX | 0x00 | 0x00 | 0xXX | 0xXX | 0xXX | 0xXX |
-
-    while (millis() - startTime < waitMillis) {
-        if (_serial_gps->available()) {
-            buffer[bufferPos++] = _serial_gps->read();
-
-            // keep looking at the first two bytes of buffer until
-            // we have found the CAS frame header (0xBA, 0xCE), if not
-            // keep reading bytes until we find a frame header or we run
-            // out of time.
-            if ((bufferPos == 2) && !(buffer[0] == 0xBA && buffer[1] == 0xCE)) {
-                buffer[0] = buffer[1];
-                buffer[1] = 0;
-                bufferPos = 1;
-            }
-        }
-
-        // we have read all the bytes required for the Ack/Nack (14-bytes)
-        // and we must have found a frame to get this far
-        if (bufferPos == sizeof(buffer) - 1) {
-            uint8_t msg_cls = buffer[4];     // message class should be 0x05
-            uint8_t msg_msg_id = buffer[5];  // message id should be 0x00 or 0x01
-            uint8_t payload_cls = buffer[6]; // payload class id
-            uint8_t payload_msg = buffer[7]; // payload message id
+    GPSReplyMatcher matcher;
+    matcher.beginText(message);
+    return waitForReply(matcher, waitMillis);
+}
 
-            // Check for an ACK-ACK for the specified class and message id
-            if ((msg_cls == 0x05) && (msg_msg_id == 0x01) && payload_cls == class_id && payload_msg == msg_id) {
+GPS_RESPONSE GPS::getACK(uint8_t class_id, uint8_t msg_id, uint32_t waitMillis)
+{
+    GPSReplyMatcher matcher;
+    matcher.beginUBXAck(class_id, msg_id);
+    GPS_RESPONSE response = waitForReply(matcher, waitMillis);
+    if (response == GNSS_RESPONSE_NAK)
+        LOG_WARN("Got NAK for class %02X message %02X\n", class_id, msg_id);
 #ifdef GPS_DEBUG
-                LOG_INFO("Got ACK for class %02X message %02X in %d millis.\n", class_id, msg_id, millis() - startTime);
+    else if (response == GNSS_RESPONSE_NONE)
+        LOG_WARN("No response for class %02X message %02X\n", class_id, msg_id);
 #endif
-                return GNSS_RESPONSE_OK;
-            }
+    return response;
+}
 
-            // Check for an ACK-NACK for the specified class and message id
-            if ((msg_cls == 0x05) && (msg_msg_id == 0x00) && payload_cls == class_id && payload_msg == msg_id) {
-#ifdef GPS_DEBUG
-                LOG_WARN("Got NACK for class %02X message %02X in %d millis.\n", class_id, msg_id, millis() - startTime);
-#endif
-                return GNSS_RESPONSE_NAK;
-            }
+GPSCommand *GPS::queueCommand(GPSCommand::Type type, GPSCommand::Reply reply)
+{
+    if (numCommands == GPS_MAX_COMMANDS) {
+        LOG_ERROR("GNSS command queue is full, raise GPS_MAX_COMMANDS\n");
+        return NULL;
+    }
+    GPSCommand *command = &commands[numCommands++];
+    memset(command, 0, sizeof(*command));
+    command->type = type;
+    command->reply = reply;
+    return command;
+}
 
-            // This isn't the frame we are looking for, clear the buffer
-            // and try again until we run out of time.
-            memset(buffer, 0x0, sizeof(buffer));
-            bufferPos = 0;
-        }
+void GPS::queueNMEA(const char *sentence, uint16_t settleMsec)
+{
+    GPSCommand *command = queueCommand(GPSCommand::NMEA, GPSCommand::NO_REPLY);
+    if (command) {
+        command->sentence = sentence;
+        command->settleMsec = settleMsec;
     }
-    return GNSS_RESPONSE_NONE;
 }
 
-GPS_RESPONSE GPS::getACK(uint8_t class_id, uint8_t msg_id, uint32_t waitMillis)
+void GPS::queueNMEA(const char *sentence, const char *expect, uint16_t timeoutMsec)
 {
-    uint8_t b;
-    uint8_t ack = 0;
-    const uint8_t ackP[2] = {class_id, msg_id};
-    uint8_t buf[10] = {0xB5, 0x62, 0x05, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00};
-    uint32_t startTime = millis();
-    const char frame_errors[] = "More than 100 frame errors";
-    int sCounter = 0;
+    GPSCommand *command = queueCommand(GPSCommand::NMEA, GPSCommand::TEXT);
+    if (command) {
+        command->sentence = sentence;
+        command->expect = expect;
+        command->timeoutMsec = timeoutMsec;
+    }
+}
 
-    for (int j = 2; j < 6; j++) {
-        buf[8] += buf[j];
-        buf[9] += buf[8];
+void GPS::queueUBX(uint8_t classId, uint8_t msgId, const uint8_t *payload, uint8_t size, uint16_t timeoutMsec,
+                   uint16_t settleMsec, const char *failure)
+{
+    GPSCommand *command = queueCommand(GPSCommand::UBX, timeoutMsec ? GPSCommand::UBX_ACK : GPSCommand::NO_REPLY);
+    if (command) {
+        command->classId = classId;
+        command->msgId = msgId;
+        command->payload = payload;
+        command->size = size;
+        command->timeoutMsec = timeoutMsec;
+        command->settleMsec = settleMsec;
+        command->failure = failure;
     }
+}
 
-    for (int j = 0; j < 2; j++) {
-        buf[6 + j] = ackP[j];
-        buf[8] += buf[6 + j];
-        buf[9] += buf[8];
+void GPS::queueUBXPoll(uint8_t classId, uint8_t msgId, uint16_t timeoutMsec)
+{
+    GPSCommand *command = queueCommand(GPSCommand::UBX, GPSCommand::UBX_MESSAGE);
+    if (command) {
+        command->classId = classId;
+        command->msgId = msgId;
+        command->timeoutMsec = timeoutMsec;
+        if (!replyBuffer)
+            replyBuffer = new uint8_t[GPS_REPLY_BUFFER_SIZE](); // zeroed
     }
+}
 
-    while (millis() - startTime < waitMillis) {
-        if (ack > 9) {
-#ifdef GPS_DEBUG
-            LOG_DEBUG("\n");
-            LOG_INFO("Got ACK for class %02X message %02X in %d millis.\n", class_id, msg_id, millis() - startTime);
-#endif
-            return GNSS_RESPONSE_OK; // ACK received
-        }
-        if (_serial_gps->available()) {
-            b = _serial_gps->read();
-            if (b == frame_errors[sCounter]) {
-                sCounter++;
-                if (sCounter == 26) {
-                    return GNSS_RESPONSE_FRAME_ERRORS;
-                }
-            } else {
-                sCounter = 0;
-            }
-#ifdef GPS_DEBUG
-            LOG_DEBUG("%02X", b);
-#endif
-            if (b == buf[ack]) {
-                ack++;
-            } else {
-                if (ack == 3 && b == 0x00) { // UBX-ACK-NAK message
-#ifdef GPS_DEBUG
-                    LOG_DEBUG("\n");
-#endif
-                    LOG_WARN("Got NAK for class %02X message %02X\n", class_id, msg_id);
-                    return GNSS_RESPONSE_NAK; // NAK received
-                }
-                ack = 0; // Reset the acknowledgement counter
+void GPS::queueCAS(uint8_t classId, uint8_t msgId, const uint8_t *payload, uint8_t size, uint16_t timeoutMsec,
+                   const char *failure)
+{
+    GPSCommand *command = queueCommand(GPSCommand::CAS, GPSCommand::CAS_ACK);
+    if (command) {
+        command->classId = classId;
+        command->msgId = msgId;
+        command->payload = payload;
+        command->size = size;
+        command->timeoutMsec = timeoutMsec;
+        command->failure = failure;
+    }
+}
+
+void GPS::queuePause(uint16_t msec)
+{
+    GPSCommand *command = queueCommand(GPSCommand::PAUSE, GPSCommand::NO_REPLY);
+    if (command)
+        command->settleMsec = msec;
+}
+
+int32_t GPS::runCommands()
+{
+    for (;;) {
+        uint32_t now = millis();
+        if (!awaitingReply) {
+            // Give the receiver the time it needs to act on the last command
+            if ((int32_t)(readyMsec - now) > 0)
+                return readyMsec - now;
+            if (nextCommand == numCommands) {
+                numCommands = nextCommand = 0;
+                return 0;
             }
+            sendCommand(commands[nextCommand]);
+            commandSentMsec = now;
+            awaitingReply = true;
+        }
+
+        GPS_RESPONSE response = GNSS_RESPONSE_NONE;
+        if (commands[nextCommand].reply == GPSCommand::NO_REPLY) {
+            response = GNSS_RESPONSE_OK;
+        } else {
+            while (response == GNSS_RESPONSE_NONE && _serial_gps->available())
+                response = replyMatcher.feed(_serial_gps->read());
+            if (response == GNSS_RESPONSE_NONE && now - commandSentMsec < commands[nextCommand].timeoutMsec)
+                return GPS_COMMAND_POLL_MSEC; // Not here yet, let everyone else run meanwhile
         }
+        finishCommand(response);
     }
-#ifdef GPS_DEBUG
-    LOG_DEBUG("\n");
-    LOG_WARN("No response for class %02X message %02X\n", class_id, msg_id);
-#endif
-    return GNSS_RESPONSE_NONE; // No response received within timeout
 }
 
-/**
- * @brief
- * @note   New method, this method can wait for the specified class and message ID, and return the payload
- * @param  *buffer: The message buffer, if there is a response payload message, it will be returned through the buffer parameter
- * @param  size:    size of buffer
- * @param  requestedClass:  request class constant
- * @param  requestedID:     request message ID constant
- * @retval length of payload message
- */
-int GPS::getACK(uint8_t *buffer, uint16_t size, uint8_t requestedClass, uint8_t requestedID, uint32_t waitMillis)
+void GPS::sendCommand(const GPSCommand &command)
 {
-    uint16_t ubxFrameCounter = 0;
-    uint32_t startTime = millis();
-    uint16_t needRead;
+    uint8_t msglen;
 
-    while (millis() - startTime < waitMillis) {
-        if (_serial_gps->available()) {
-            int c = _serial_gps->read();
-            switch (ubxFrameCounter) {
-            case 0:
-                // ubxFrame 'μ'
-                if (c == 0xB5) {
-                    ubxFrameCounter++;
-                }
-                break;
-            case 1:
-                // ubxFrame 'b'
-                if (c == 0x62) {
-                    ubxFrameCounter++;
-                } else {
-                    ubxFrameCounter = 0;
-                }
-                break;
-            case 2:
-                // Class
-                if (c == requestedClass) {
-                    ubxFrameCounter++;
-                } else {
-                    ubxFrameCounter = 0;
-                }
-                break;
-            case 3:
-                // Message ID
-                if (c == requestedID) {
-                    ubxFrameCounter++;
-                } else {
-                    ubxFrameCounter = 0;
-                }
-                break;
-            case 4:
-                // Payload length lsb
-                needRead = c;
-                ubxFrameCounter++;
-                break;
-            case 5:
-                // Payload length msb
-                needRead |= (c << 8);
-                ubxFrameCounter++;
-                // Check for buffer overflow
-                if (needRead >= size) {
-                    ubxFrameCounter = 0;
-                    break;
-                }
-                if (_serial_gps->readBytes(buffer, needRead) != needRead) {
-                    ubxFrameCounter = 0;
-                } else {
-                    // return payload length
-#ifdef GPS_DEBUG
-                    LOG_INFO("Got ACK for class %02X message %02X in %d millis.\n", requestedClass, requestedID,
-                             millis() - startTime);
-#endif
-                    return needRead;
-                }
-                break;
+    if (command.reply != GPSCommand::NO_REPLY) {
+        clearBuffer(); // So we only see what the receiver says after this
+        replyMatcher.begin(command, replyBuffer, replyBuffer ? GPS_REPLY_BUFFER_SIZE : 0);
+    }
 
-            default:
-                break;
-            }
-        }
+    switch (command.type) {
+    case GPSCommand::NMEA:
+        _serial_gps->write(command.sentence);
+        break;
+    case GPSCommand::UBX:
+        msglen = makeUBXPacket(command.classId, command.msgId, command.size, command.payload);
+        _serial_gps->write(UBXscratch, msglen);
+        break;
+    case GPSCommand::CAS:
+        msglen = makeCASPacket(command.classId, command.msgId, command.size, command.payload);
+        _serial_gps->write(UBXscratch, msglen);
+        break;
+    default:
+        break;
     }
-    // LOG_WARN("No response for class %02X message %02X\n", requestedClass, requestedID);
-    return 0;
+    numCommandsSent++;
 }
 
-bool GPS::setup()
+static const char *responseToString(GPS_RESPONSE response)
 {
-    int msglen = 0;
+    switch (response) {
+    case GNSS_RESPONSE_NAK:
+        return "NAK";
+    case GNSS_RESPONSE_FRAME_ERRORS:
+        return "frame errors";
+    case GNSS_RESPONSE_OK:
+        return "OK";
+    default:
+        return "no reply";
+    }
+}
 
-    if (!didSerialInit) {
-#if !defined(GPS_UC6580)
+void GPS::finishCommand(GPS_RESPONSE response)
+{
+    const GPSCommand &command = commands[nextCommand++];
+    uint32_t now = millis();
+    awaitingReply = false;
+    lastResponse = response;
+
+    // A receiver that NAKed a command didn't act on it, so needs no time to settle
+    uint16_t settleMsec = (response == GNSS_RESPONSE_NAK) ? 0 : command.settleMsec;
+    readyMsec = now + settleMsec;
+
+    // Per command timing, to see where setup spends its time
+    const char *result = (command.reply == GPSCommand::NO_REPLY) ? "sent" : responseToString(response);
+    if (command.type == GPSCommand::NMEA)
+        LOG_DEBUG("GNSS %.*s: %s after %ums, settling %ums\n", (int)strcspn(command.sentence, "*\r"), command.sentence,
+                  result, now - commandSentMsec, settleMsec);
+    else if (command.type != GPSCommand::PAUSE)
+        LOG_DEBUG("GNSS %s %02X %02X: %s after %ums, settling %ums\n", command.type == GPSCommand::UBX ? "UBX" : "CAS",
+                  command.classId, command.msgId, result, now - commandSentMsec, settleMsec);
+
+    if (response != GNSS_RESPONSE_OK && command.failure)
+        LOG_WARN("%s\n", command.failure);
+}
 
-        if (tx_gpio && gnssModel == GNSS_MODEL_UNKNOWN) {
-            LOG_DEBUG("Probing for GPS at %d \n", serialSpeeds[speedSelect]);
-            gnssModel = probe(serialSpeeds[speedSelect]);
-            if (gnssModel == GNSS_MODEL_UNKNOWN) {
-                if (++speedSelect == sizeof(serialSpeeds) / sizeof(int)) {
-                    speedSelect = 0;
-                    if (--probeTries == 0) {
-                        LOG_WARN("Giving up on GPS probe and setting to 9600.\n");
-                        return true;
-                    }
+void GPS::setSerialSpeed(int serialSpeed)
+{
+#if defined(ARCH_NRF52) || defined(ARCH_PORTDUINO) || defined(ARCH_RP2040)
+    _serial_gps->end();
+    _serial_gps->begin(serialSpeed);
+#else
+    if (_serial_gps->baudRate() != serialSpeed) {
+        LOG_DEBUG("Setting Baud to %i\n", serialSpeed);
+        _serial_gps->updateBaudRate(serialSpeed);
+    }
+#endif
+}
+
+int32_t GPS::setup()
+{
+    for (;;) {
+        int32_t wait = runCommands();
+        if (wait)
+            return wait;
+
+        switch (setupStage) {
+        case GPS_SETUP_PROBE:
+            if (didSerialInit) {
+                setupStage = GPS_SETUP_DONE;
+                break;
+            }
+            if (!numCommandsSent)
+                setupStartMsec = millis();
+#if !defined(GPS_UC6580)
+            if (tx_gpio && gnssModel == GNSS_MODEL_UNKNOWN) {
+                LOG_DEBUG("Probing for GPS at %d \n", serialSpeeds[speedSelect]);
+                setSerialSpeed(serialSpeeds[speedSelect]);
+#ifdef GPS_DEBUG
+                for (int i = 0; i < 20; i++) {
+                    getACK("$GP", 200);
                 }
-                return false;
+#endif
+                memset(&info, 0, sizeof(struct uBloxGnssModelInfo));
+                queuePause(100);
+                // Close all NMEA sentences, valid for L76K, ATGM336H (and likely other AT6558 devices)
+                queueNMEA("$PCAS03,0,0,0,0,0,0,0,0,0,0,,,0,0*02\r\n", 20);
+                // Get version information
+                queueNMEA("$PCAS06,1*1A\r\n", "$GPTXT,01,01,02,HW=ATGM336H", 500);
+                setupStage = GPS_SETUP_PROBE_ATGM336H;
+            } else {
+                gnssModel = GNSS_MODEL_UNKNOWN;
+                setupStage = GPS_SETUP_CONFIGURE;
             }
-        } else {
-            gnssModel = GNSS_MODEL_UNKNOWN;
-        }
 #else
-        gnssModel = GNSS_MODEL_UC6580;
+            gnssModel = GNSS_MODEL_UC6580;
+            setupStage = GPS_SETUP_CONFIGURE;
 #endif
+            break;
 
-        if (gnssModel == GNSS_MODEL_MTK) {
-            /*
-             * t-beam-s3-core uses the same L76K GNSS module as t-echo.
-             * Unlike t-echo, L76K uses 9600 baud rate for communication by default.
-             * */
-
-            // Initialize the L76K Chip, use GPS + GLONASS + BEIDOU
-            _serial_gps->write("$PCAS04,7*1E\r\n");
-            delay(250);
-            // only ask for RMC and GGA
-            _serial_gps->write("$PCAS03,1,0,0,0,1,0,0,0,0,0,,,0,0*02\r\n");
-            delay(250);
-            // Switch to Vehicle Mode, since SoftRF enables Aviation < 2g
-            _serial_gps->write("$PCAS11,3*1E\r\n");
-            delay(250);
-        } else if (gnssModel == GNSS_MODEL_MTK_L76B) {
-            // Waveshare Pico-GPS hat uses the L76B with 9600 baud
-            // Initialize the L76B Chip, use GPS + GLONASS
-            // See note in L76_Series_GNSS_Protocol_Specification, chapter 3.29
-            _serial_gps->write("$PMTK353,1,1,0,0,0*2B\r\n");
-            // Above command will reset the GPS and takes longer before it will accept new commands
-            delay(1000);
-            // only ask for RMC and GGA (GNRMC and GNGGA)
-            // See note in L76_Series_GNSS_Protocol_Specification, chapter 2.1
-            _serial_gps->write("$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n");
-            delay(250);
-            // Enable SBAS
-            _serial_gps->write("$PMTK301,2*2E\r\n");
-            delay(250);
-            // Enable PPS for 2D/3D fix only
-            _serial_gps->write("$PMTK285,3,100*3F\r\n");
-            delay(250);
-            // Switch to Fitness Mode, for running and walking purpose with low speed (<5 m/s)
-            _serial_gps->write("$PMTK886,1*29\r\n");
-            delay(250);
-        } else if (gnssModel == GNSS_MODEL_ATGM336H) {
-            // Set the intial configuration of the device - these _should_ work for most AT6558 devices
-            msglen = makeCASPacket(0x06, 0x07, sizeof(_message_CAS_CFG_NAVX_CONF), _message_CAS_CFG_NAVX_CONF);
-            _serial_gps->write(UBXscratch, msglen);
-            if (getACKCas(0x06, 0x07, 250) != GNSS_RESPONSE_OK) {
-                LOG_WARN("ATGM336H - Could not set Configuration");
+        case GPS_SETUP_PROBE_ATGM336H:
+            if (lastResponse == GNSS_RESPONSE_OK) {
+                LOG_INFO("ATGM336H GNSS init succeeded, using ATGM336H Module\n");
+                gnssModel = GNSS_MODEL_ATGM336H;
+                setupStage = GPS_SETUP_CONFIGURE;
+                break;
             }
+            // Get version information
+            queueNMEA("$PCAS06,0*1B\r\n", "$GPTXT,01,01,02,SW=", 500);
+            setupStage = GPS_SETUP_PROBE_L76K;
+            break;
 
-            // Set the update frequence to 1Hz
-            msglen = makeCASPacket(0x06, 0x04, sizeof(_message_CAS_CFG_RATE_1HZ), _message_CAS_CFG_RATE_1HZ);
-            _serial_gps->write(UBXscratch, msglen);
-            if (getACKCas(0x06, 0x04, 250) != GNSS_RESPONSE_OK) {
-                LOG_WARN("ATGM336H - Could not set Update Frequency");
+        case GPS_SETUP_PROBE_L76K:
+            if (lastResponse == GNSS_RESPONSE_OK) {
+                LOG_INFO("L76K GNSS init succeeded, using L76K GNSS Module\n");
+                gnssModel = GNSS_MODEL_MTK;
+                setupStage = GPS_SETUP_CONFIGURE;
+                break;
             }
+            // Close all NMEA sentences, valid for L76B MTK platform (Waveshare Pico GPS)
+            queueNMEA("$PMTK514,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*2E\r\n", 20);
+            // Get version information
+            queueNMEA("$PMTK605*31\r\n", "Quectel-L76B", 500);
+            setupStage = GPS_SETUP_PROBE_L76B;
+            break;
 
-            // Set the NEMA output messages
-            // Ask for only RMC and GGA
-            uint8_t fields[] = {CAS_NEMA_RMC, CAS_NEMA_GGA};
-            for (unsigned int i = 0; i < sizeof(fields); i++) {
-                // Construct a CAS-CFG-MSG packet
-                uint8_t cas_cfg_msg_packet[] = {0x4e, fields[i], 0x01, 0x00};
-                msglen = makeCASPacket(0x06, 0x01, sizeof(cas_cfg_msg_packet), cas_cfg_msg_packet);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACKCas(0x06, 0x01, 250) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("ATGM336H - Could not enable NMEA MSG: %d\n", fields[i]);
-                }
+        case GPS_SETUP_PROBE_L76B:
+            if (lastResponse == GNSS_RESPONSE_OK) {
+                LOG_INFO("L76B GNSS init succeeded, using L76B GNSS Module\n");
+                gnssModel = GNSS_MODEL_MTK_L76B;
+                setupStage = GPS_SETUP_CONFIGURE;
+                break;
             }
-        } else if (gnssModel == GNSS_MODEL_UC6580) {
-            // The Unicore UC6580 can use a lot of sat systems, enable it to
-            // use GPS L1 & L5 + BDS B1I & B2a + GLONASS L1 + GALILEO E1 & E5a + SBAS
-            // This will reset the receiver, so wait a bit afterwards
-            // The paranoid will wait for the OK*04 confirmation response after each command.
-            _serial_gps->write("$CFGSYS,h25155\r\n");
-            delay(750);
-            // Must be done after the CFGSYS command
-            // Turn off GSV messages, we don't really care about which and where the sats are, maybe someday.
-            _serial_gps->write("$CFGMSG,0,3,0\r\n");
-            delay(250);
-            // Turn off GSA messages, TinyGPS++ doesn't use this message.
-            _serial_gps->write("$CFGMSG,0,2,0\r\n");
-            delay(250);
-            // Turn off NOTICE __TXT messages, these may provide Unicore some info but we don't care.
-            _serial_gps->write("$CFGMSG,6,0,0\r\n");
-            delay(250);
-            _serial_gps->write("$CFGMSG,6,1,0\r\n");
-            delay(250);
-        } else if (gnssModel == GNSS_MODEL_UBLOX) {
-            // Configure GNSS system to GPS+SBAS+GLONASS (Module may restart after this command)
-            // We need set it because by default it is GPS only, and we want to use GLONASS too
-            // Also we need SBAS for better accuracy and extra features
-            // ToDo: Dynamic configure GNSS systems depending of LoRa region
-
-            if (strncmp(info.hwVersion, "000A0000", 8) != 0) {
-                if (strncmp(info.hwVersion, "00040007", 8) != 0) {
-                    // The original ublox Neo-6 is GPS only and doesn't support the UBX-CFG-GNSS message
-                    // Max7 seems to only support GPS *or* GLONASS
-                    // Neo-7 is supposed to support GPS *and* GLONASS but NAKs the CFG-GNSS command to do it
-                    // So treat all the u-blox 7 series as GPS only
-                    // M8 can support 3 constallations at once so turn on GPS, GLONASS and Galileo (or BeiDou)
-
-                    if (strncmp(info.hwVersion, "00070000", 8) == 0) {
-                        LOG_DEBUG("Setting GPS+SBAS\n");
-                        msglen = makeUBXPacket(0x06, 0x3e, sizeof(_message_GNSS_7), _message_GNSS_7);
-                        _serial_gps->write(UBXscratch, msglen);
-                    } else {
-                        msglen = makeUBXPacket(0x06, 0x3e, sizeof(_message_GNSS_8), _message_GNSS_8);
-                        _serial_gps->write(UBXscratch, msglen);
-                    }
-
-                    if (getACK(0x06, 0x3e, 800) == GNSS_RESPONSE_NAK) {
-                        // It's not critical if the module doesn't acknowledge this configuration.
-                        LOG_INFO("Unable to reconfigure GNSS - defaults maintained. Is this module GPS-only?\n");
-                    } else {
-                        if (strncmp(info.hwVersion, "00070000", 8) == 0) {
-                            LOG_INFO("GNSS configured for GPS+SBAS. Pause for 0.75s before sending next command.\n");
-                        } else {
-                            LOG_INFO(
-                                "GNSS configured for GPS+SBAS+GLONASS+Galileo. Pause for 0.75s before sending next command.\n");
-                        }
-                        // Documentation say, we need wait atleast 0.5s after reconfiguration of GNSS module, before sending next
-                        // commands for the M8 it tends to be more... 1 sec should be enough ;>)
-                        delay(1000);
-                    }
-                }
-                // Disable Text Info messages
-                msglen = makeUBXPacket(0x06, 0x02, sizeof(_message_DISABLE_TXT_INFO), _message_DISABLE_TXT_INFO);
-                clearBuffer();
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x02, 500) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to disable text info messages.\n");
-                }
-                // ToDo add M10 tests for below
-                if (strncmp(info.hwVersion, "00080000", 8) == 0) {
-                    msglen = makeUBXPacket(0x06, 0x39, sizeof(_message_JAM_8), _message_JAM_8);
-                    clearBuffer();
-                    _serial_gps->write(UBXscratch, msglen);
-                    if (getACK(0x06, 0x39, 500) != GNSS_RESPONSE_OK) {
-                        LOG_WARN("Unable to enable interference resistance.\n");
-                    }
-
-                    msglen = makeUBXPacket(0x06, 0x23, sizeof(_message_NAVX5_8), _message_NAVX5_8);
-                    clearBuffer();
-                    _serial_gps->write(UBXscratch, msglen);
-                    if (getACK(0x06, 0x23, 500) != GNSS_RESPONSE_OK) {
-                        LOG_WARN("Unable to configure NAVX5_8 settings.\n");
-                    }
-                } else {
-                    msglen = makeUBXPacket(0x06, 0x39, sizeof(_message_JAM_6_7), _message_JAM_6_7);
-                    _serial_gps->write(UBXscratch, msglen);
-                    if (getACK(0x06, 0x39, 500) != GNSS_RESPONSE_OK) {
-                        LOG_WARN("Unable to enable interference resistance.\n");
-                    }
+            // Poll UBX-CFG-RATE, any u-blox will ACK it
+            queueUBX(0x06, 0x08, NULL, 0, 750);
+            setupStage = GPS_SETUP_PROBE_UBLOX;
+            break;
 
-                    msglen = makeUBXPacket(0x06, 0x23, sizeof(_message_NAVX5), _message_NAVX5);
-                    _serial_gps->write(UBXscratch, msglen);
-                    if (getACK(0x06, 0x23, 500) != GNSS_RESPONSE_OK) {
-                        LOG_WARN("Unable to configure NAVX5 settings.\n");
+        case GPS_SETUP_PROBE_UBLOX:
+            if (lastResponse == GNSS_RESPONSE_NONE) {
+                LOG_WARN("Failed to find UBlox & MTK GNSS Module using baudrate %d\n", serialSpeeds[speedSelect]);
+                setupStage = GPS_SETUP_PROBE;
+                if (++speedSelect == sizeof(serialSpeeds) / sizeof(int)) {
+                    speedSelect = 0;
+                    if (--probeTries == 0) {
+                        LOG_WARN("Giving up on GPS probe and setting to 9600.\n");
+                        setupStage = GPS_SETUP_DONE;
+                        break;
                     }
                 }
-                // Turn off unwanted NMEA messages, set update rate
+                return 2000; // Try the next speed in two seconds
+            } else if (lastResponse == GNSS_RESPONSE_FRAME_ERRORS) {
+                LOG_INFO("UBlox Frame Errors using baudrate %d\n", serialSpeeds[speedSelect]);
+            } else if (lastResponse == GNSS_RESPONSE_OK) {
+                LOG_INFO("Found a UBlox Module using baudrate %d\n", serialSpeeds[speedSelect]);
+            }
 
-                msglen = makeUBXPacket(0x06, 0x08, sizeof(_message_1HZ), _message_1HZ);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x08, 500) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to set GPS update rate.\n");
-                }
+            // tips: NMEA Only should not be set here, otherwise initializing Ublox gnss module again after
+            // setting will not output command messages in UART1, resulting in unrecognized module information
+            if (serialSpeeds[speedSelect] != 9600) {
+                // Set the UART port to 9600
+                queueUBX(0x06, 0x00, _message_PRT_9600, sizeof(_message_PRT_9600), 0, 500);
+                setupStage = GPS_SETUP_PROBE_UBLOX_BAUD;
+                break;
+            }
+            //  Get Ublox gnss module hardware and software info
+            queueUBXPoll(0x0A, 0x04, 1200);
+            setupStage = GPS_SETUP_PROBE_UBLOX_VERSION;
+            break;
 
-                msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_GLL), _message_GLL);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to disable NMEA GLL.\n");
-                }
+        case GPS_SETUP_PROBE_UBLOX_BAUD:
+            setSerialSpeed(9600);
+            queuePause(200);
+            queueUBXPoll(0x0A, 0x04, 1200);
+            setupStage = GPS_SETUP_PROBE_UBLOX_VERSION;
+            break;
 
-                msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_GSA), _message_GSA);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to Enable NMEA GSA.\n");
-                }
+        case GPS_SETUP_PROBE_UBLOX_VERSION:
+            if (lastResponse == GNSS_RESPONSE_OK)
+                parseMonVer(replyBuffer, replyMatcher.getLength());
+            delete[] replyBuffer;
+            replyBuffer = NULL;
+            gnssModel = GNSS_MODEL_UBLOX;
+            setupStage = GPS_SETUP_CONFIGURE;
+            break;
 
-                msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_GSV), _message_GSV);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to disable NMEA GSV.\n");
-                }
+        case GPS_SETUP_CONFIGURE:
+            queueConfiguration();
+            setupStage = GPS_SETUP_CONFIGURING;
+            break;
 
-                msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_VTG), _message_VTG);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to disable NMEA VTG.\n");
+        case GPS_SETUP_CONFIGURING:
+            if (gnssModel == GNSS_MODEL_UBLOX) {
+                // The save is the last command of every u-blox configuration
+                if (lastResponse != GNSS_RESPONSE_OK) {
+                    LOG_WARN("Unable to save GNSS module configuration.\n");
+                } else {
+                    LOG_INFO("GNSS module configuration saved!\n");
                 }
+            }
+            LOG_INFO("GNSS setup done in %ums, %u commands sent\n", millis() - setupStartMsec, numCommandsSent);
+            didSerialInit = true;
+            setupStage = GPS_SETUP_DONE;
+            break;
 
-                msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_RMC), _message_RMC);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to enable NMEA RMC.\n");
-                }
+        case GPS_SETUP_DONE:
+            notifyDeepSleepObserver.observe(&notifyDeepSleep);
+            return 0;
+        }
+    }
+}
 
-                msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_GGA), _message_GGA);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to enable NMEA GGA.\n");
-                }
+void GPS::queueConfiguration()
+{
+    if (gnssModel == GNSS_MODEL_MTK) {
+        /*
+         * t-beam-s3-core uses the same L76K GNSS module as t-echo.
+         * Unlike t-echo, L76K uses 9600 baud rate for communication by default.
+         * */
+
+        // Initialize the L76K Chip, use GPS + GLONASS + BEIDOU
+        queueNMEA("$PCAS04,7*1E\r\n", 250);
+        // only ask for RMC and GGA
+        queueNMEA("$PCAS03,1,0,0,0,1,0,0,0,0,0,,,0,0*02\r\n", 250);
+        // Switch to Vehicle Mode, since SoftRF enables Aviation < 2g
+        queueNMEA("$PCAS11,3*1E\r\n", 250);
+    } else if (gnssModel == GNSS_MODEL_MTK_L76B) {
+        // Waveshare Pico-GPS hat uses the L76B with 9600 baud
+        // Initialize the L76B Chip, use GPS + GLONASS
+        // See note in L76_Series_GNSS_Protocol_Specification, chapter 3.29
+        // This command will reset the GPS and takes longer before it will accept new commands
+        queueNMEA("$PMTK353,1,1,0,0,0*2B\r\n", 1000);
+        // only ask for RMC and GGA (GNRMC and GNGGA)
+        // See note in L76_Series_GNSS_Protocol_Specification, chapter 2.1
+        queueNMEA("$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n", 250);
+        // Enable SBAS
+        queueNMEA("$PMTK301,2*2E\r\n", 250);
+        // Enable PPS for 2D/3D fix only
+        queueNMEA("$PMTK285,3,100*3F\r\n", 250);
+        // Switch to Fitness Mode, for running and walking purpose with low speed (<5 m/s)
+        queueNMEA("$PMTK886,1*29\r\n", 250);
+    } else if (gnssModel == GNSS_MODEL_ATGM336H) {
+        // Set the intial configuration of the device - these _should_ work for most AT6558 devices
+        queueCAS(0x06, 0x07, _message_CAS_CFG_NAVX_CONF, sizeof(_message_CAS_CFG_NAVX_CONF), 250,
+                 "ATGM336H - Could not set Configuration");
+        // Set the update frequence to 1Hz
+        queueCAS(0x06, 0x04, _message_CAS_CFG_RATE_1HZ, sizeof(_message_CAS_CFG_RATE_1HZ), 250,
+                 "ATGM336H - Could not set Update Frequency");
+        // Set the NEMA output messages
+        // Ask for only RMC and GGA
+        queueCAS(0x06, 0x01, _message_CAS_CFG_MSG_RMC, sizeof(_message_CAS_CFG_MSG_RMC), 250,
+                 "ATGM336H - Could not enable NMEA MSG: RMC");
+        queueCAS(0x06, 0x01, _message_CAS_CFG_MSG_GGA, sizeof(_message_CAS_CFG_MSG_GGA), 250,
+                 "ATGM336H - Could not enable NMEA MSG: GGA");
+    } else if (gnssModel == GNSS_MODEL_UC6580) {
+        // The Unicore UC6580 can use a lot of sat systems, enable it to
+        // use GPS L1 & L5 + BDS B1I & B2a + GLONASS L1 + GALILEO E1 & E5a + SBAS
+        // This will reset the receiver, so wait a bit afterwards
+        // The paranoid will wait for the OK*04 confirmation response after each command.
+        queueNMEA("$CFGSYS,h25155\r\n", 750);
+        // Must be done after the CFGSYS command
+        // Turn off GSV messages, we don't really care about which and where the sats are, maybe someday.
+        queueNMEA("$CFGMSG,0,3,0\r\n", 250);
+        // Turn off GSA messages, TinyGPS++ doesn't use this message.
+        queueNMEA("$CFGMSG,0,2,0\r\n", 250);
+        // Turn off NOTICE __TXT messages, these may provide Unicore some info but we don't care.
+        queueNMEA("$CFGMSG,6,0,0\r\n", 250);
+        queueNMEA("$CFGMSG,6,1,0\r\n", 250);
+    } else if (gnssModel == GNSS_MODEL_UBLOX) {
+        // Configure GNSS system to GPS+SBAS+GLONASS (Module may restart after this command)
+        // We need set it because by default it is GPS only, and we want to use GLONASS too
+        // Also we need SBAS for better accuracy and extra features
+        // ToDo: Dynamic configure GNSS systems depending of LoRa region
 
-                if (uBloxProtocolVersion >= 18) {
-                    msglen = makeUBXPacket(0x06, 0x86, sizeof(_message_PMS), _message_PMS);
-                    clearBuffer();
-                    _serial_gps->write(UBXscratch, msglen);
-                    if (getACK(0x06, 0x86, 500) != GNSS_RESPONSE_OK) {
-                        LOG_WARN("Unable to enable powersaving for GPS.\n");
-                    }
-                    msglen = makeUBXPacket(0x06, 0x3B, sizeof(_message_CFG_PM2), _message_CFG_PM2);
-                    _serial_gps->write(UBXscratch, msglen);
-                    if (getACK(0x06, 0x3B, 500) != GNSS_RESPONSE_OK) {
-                        LOG_WARN("Unable to enable powersaving details for GPS.\n");
-                    }
-                    // For M8 we want to enable NMEA vserion 4.10 so we can see the additional sats.
-                    if (strncmp(info.hwVersion, "00080000", 8) == 0) {
-                        msglen = makeUBXPacket(0x06, 0x17, sizeof(_message_NMEA), _message_NMEA);
-                        clearBuffer();
-                        _serial_gps->write(UBXscratch, msglen);
-                        if (getACK(0x06, 0x17, 500) != GNSS_RESPONSE_OK) {
-                            LOG_WARN("Unable to enable NMEA 4.10.\n");
-                        }
-                    }
+        if (strncmp(info.hwVersion, "000A0000", 8) != 0) {
+            if (strncmp(info.hwVersion, "00040007", 8) != 0) {
+                // The original ublox Neo-6 is GPS only and doesn't support the UBX-CFG-GNSS message
+                // Max7 seems to only support GPS *or* GLONASS
+                // Neo-7 is supposed to support GPS *and* GLONASS but NAKs the CFG-GNSS command to do it
+                // So treat all the u-blox 7 series as GPS only
+                // M8 can support 3 constallations at once so turn on GPS, GLONASS and Galileo (or BeiDou)
+
+                // Documentation say, we need wait atleast 0.5s after reconfiguration of GNSS module, before sending next
+                // commands for the M8 it tends to be more... 1 sec should be enough ;>)
+                // It's not critical if the module doesn't acknowledge this configuration.
+                if (strncmp(info.hwVersion, "00070000", 8) == 0) {
+                    LOG_DEBUG("Setting GPS+SBAS\n");
+                    queueUBX(0x06, 0x3e, _message_GNSS_7, sizeof(_message_GNSS_7), 800, 1000,
+                             "Unable to reconfigure GNSS - defaults maintained. Is this module GPS-only?");
                 } else {
-                    if (strncmp(info.hwVersion, "00040007", 8) == 0) { // This PSM mode is only for Neo-6
-                        msglen = makeUBXPacket(0x06, 0x11, 0x2, _message_CFG_RXM_ECO);
-                        _serial_gps->write(UBXscratch, msglen);
-                        if (getACK(0x06, 0x11, 500) != GNSS_RESPONSE_OK) {
-                            LOG_WARN("Unable to enable powersaving ECO mode for Neo-6.\n");
-                        }
-                        msglen = makeUBXPacket(0x06, 0x3B, sizeof(_message_CFG_PM2), _message_CFG_PM2);
-                        _serial_gps->write(UBXscratch, msglen);
-                        if (getACK(0x06, 0x3B, 500) != GNSS_RESPONSE_OK) {
-                            LOG_WARN("Unable to enable powersaving details for GPS.\n");
-                        }
-                        msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_AID), _message_AID);
-                        _serial_gps->write(UBXscratch, msglen);
-                        if (getACK(0x06, 0x01, 500) != GNSS_RESPONSE_OK) {
-                            LOG_WARN("Unable to disable UBX-AID.\n");
-                        }
-                    } else {
-                        msglen = makeUBXPacket(0x06, 0x11, 0x2, _message_CFG_RXM_PSM);
-                        _serial_gps->write(UBXscratch, msglen);
-                        if (getACK(0x06, 0x11, 500) != GNSS_RESPONSE_OK) {
-                            LOG_WARN("Unable to enable powersaving mode for GPS.\n");
-                        }
-
-                        msglen = makeUBXPacket(0x06, 0x3B, sizeof(_message_CFG_PM2), _message_CFG_PM2);
-                        _serial_gps->write(UBXscratch, msglen);
-                        if (getACK(0x06, 0x3B, 500) != GNSS_RESPONSE_OK) {
-                            LOG_WARN("Unable to enable powersaving details for GPS.\n");
-                        }
-                    }
+                    queueUBX(0x06, 0x3e, _message_GNSS_8, sizeof(_message_GNSS_8), 800, 1000,
+                             "Unable to reconfigure GNSS - defaults maintained. Is this module GPS-only?");
                 }
+            }
+            // Disable Text Info messages
+            queueUBX(0x06, 0x02, _message_DISABLE_TXT_INFO, sizeof(_message_DISABLE_TXT_INFO), 500, 0,
+                     "Unable to disable text info messages.");
+            // ToDo add M10 tests for below
+            if (strncmp(info.hwVersion, "00080000", 8) == 0) {
+                queueUBX(0x06, 0x39, _message_JAM_8, sizeof(_message_JAM_8), 500, 0,
+                         "Unable to enable interference resistance.");
+                queueUBX(0x06, 0x23, _message_NAVX5_8, sizeof(_message_NAVX5_8), 500, 0,
+                         "Unable to configure NAVX5_8 settings.");
             } else {
-                // LOG_INFO("u-blox M10 hardware found.\n");
-                delay(1000);
-                // First disable all NMEA messages in RAM layer
-                msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_DISABLE_NMEA_RAM), _message_VALSET_DISABLE_NMEA_RAM);
-                clearBuffer();
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to disable NMEA messages for M10 GPS RAM.\n");
-                }
-                delay(250);
-                // Next disable unwanted NMEA messages in BBR layer
-                msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_DISABLE_NMEA_BBR), _message_VALSET_DISABLE_NMEA_BBR);
-                clearBuffer();
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to disable NMEA messages for M10 GPS BBR.\n");
-                }
-                delay(250);
-                // Disable Info txt messages in RAM layer
-                msglen =
-                    makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_DISABLE_TXT_INFO_RAM), _message_VALSET_DISABLE_TXT_INFO_RAM);
-                clearBuffer();
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to disable Info messages for M10 GPS RAM.\n");
-                }
-                delay(250);
-                // Next disable Info txt messages in BBR layer
-                msglen =
-                    makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_DISABLE_TXT_INFO_BBR), _message_VALSET_DISABLE_TXT_INFO_BBR);
-                clearBuffer();
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to disable Info messages for M10 GPS BBR.\n");
-                }
-                // Do M10 configuration for Power Management.
-
-                msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_PM_RAM), _message_VALSET_PM_RAM);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to enable powersaving for M10 GPS RAM.\n");
-                }
-                msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_PM_BBR), _message_VALSET_PM_BBR);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to enable powersaving for M10 GPS BBR.\n");
-                }
-
-                delay(250);
-                msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_ITFM_RAM), _message_VALSET_ITFM_RAM);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to enable Jamming detection M10 GPS RAM.\n");
-                }
-                msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_ITFM_BBR), _message_VALSET_ITFM_BBR);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to enable Jamming detection M10 GPS BBR.\n");
-                }
-
-                // Here is where the init commands should go to do further M10 initialization.
-                delay(250);
-                msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_DISABLE_SBAS_RAM), _message_VALSET_DISABLE_SBAS_RAM);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to disable SBAS M10 GPS RAM.\n");
-                }
-                delay(750); // will cause a receiver restart so wait a bit
-                msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_DISABLE_SBAS_BBR), _message_VALSET_DISABLE_SBAS_BBR);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to disable SBAS M10 GPS BBR.\n");
-                }
-                delay(750); // will cause a receiver restart so wait a bit
-                // Done with initialization, Now enable wanted NMEA messages in BBR layer so they will survive a periodic sleep.
-                msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_ENABLE_NMEA_BBR), _message_VALSET_ENABLE_NMEA_BBR);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to enable messages for M10 GPS BBR.\n");
-                }
-                delay(250);
-                // Next enable wanted NMEA messages in RAM layer
-                msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_ENABLE_NMEA_RAM), _message_VALSET_ENABLE_NMEA_RAM);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACK(0x06, 0x8A, 300) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("Unable to enable messages for M10 GPS RAM.\n");
-                }
-                // As the M10 has no flash, the best we can do to preserve the config is to set it in RAM and BBR.
-                // BBR will survive a restart, and power off for a while, but modules with small backup
-                // batteries or super caps will not retain the config for a long power off time.
+                queueUBX(0x06, 0x39, _message_JAM_6_7, sizeof(_message_JAM_6_7), 500, 0,
+                         "Unable to enable interference resistance.");
+                queueUBX(0x06, 0x23, _message_NAVX5, sizeof(_message_NAVX5), 500, 0, "Unable to configure NAVX5 settings.");
             }
-            msglen = makeUBXPacket(0x06, 0x09, sizeof(_message_SAVE), _message_SAVE);
-            _serial_gps->write(UBXscratch, msglen);
-            if (getACK(0x06, 0x09, 2000) != GNSS_RESPONSE_OK) {
-                LOG_WARN("Unable to save GNSS module configuration.\n");
+            // Turn off unwanted NMEA messages, set update rate
+            queueUBX(0x06, 0x08, _message_1HZ, sizeof(_message_1HZ), 500, 0, "Unable to set GPS update rate.");
+            queueUBX(0x06, 0x01, _message_GLL, sizeof(_message_GLL), 500, 0, "Unable to disable NMEA GLL.");
+            queueUBX(0x06, 0x01, _message_GSA, sizeof(_message_GSA), 500, 0, "Unable to Enable NMEA GSA.");
+            queueUBX(0x06, 0x01, _message_GSV, sizeof(_message_GSV), 500, 0, "Unable to disable NMEA GSV.");
+            queueUBX(0x06, 0x01, _message_VTG, sizeof(_message_VTG), 500, 0, "Unable to disable NMEA VTG.");
+            queueUBX(0x06, 0x01, _message_RMC, sizeof(_message_RMC), 500, 0, "Unable to enable NMEA RMC.");
+            queueUBX(0x06, 0x01, _message_GGA, sizeof(_message_GGA), 500, 0, "Unable to enable NMEA GGA.");
+
+            if (uBloxProtocolVersion >= 18) {
+                queueUBX(0x06, 0x86, _message_PMS, sizeof(_message_PMS), 500, 0, "Unable to enable powersaving for GPS.");
+                queueUBX(0x06, 0x3B, _message_CFG_PM2, sizeof(_message_CFG_PM2), 500, 0,
+                         "Unable to enable powersaving details for GPS.");
+                // For M8 we want to enable NMEA vserion 4.10 so we can see the additional sats.
+                if (strncmp(info.hwVersion, "00080000", 8) == 0) {
+                    queueUBX(0x06, 0x17, _message_NMEA, sizeof(_message_NMEA), 500, 0, "Unable to enable NMEA 4.10.");
+                }
             } else {
-                LOG_INFO("GNSS module configuration saved!\n");
+                if (strncmp(info.hwVersion, "00040007", 8) == 0) { // This PSM mode is only for Neo-6
+                    queueUBX(0x06, 0x11, _message_CFG_RXM_ECO, 0x2, 500, 0,
+                             "Unable to enable powersaving ECO mode for Neo-6.");
+                    queueUBX(0x06, 0x3B, _message_CFG_PM2, sizeof(_message_CFG_PM2), 500, 0,
+                             "Unable to enable powersaving details for GPS.");
+                    queueUBX(0x06, 0x01, _message_AID, sizeof(_message_AID), 500, 0, "Unable to disable UBX-AID.");
+                } else {
+                    queueUBX(0x06, 0x11, _message_CFG_RXM_PSM, 0x2, 500, 0, "Unable to enable powersaving mode for GPS.");
+                    queueUBX(0x06, 0x3B, _message_CFG_PM2, sizeof(_message_CFG_PM2), 500, 0,
+                             "Unable to enable powersaving details for GPS.");
+                }
             }
+        } else {
+            // LOG_INFO("u-blox M10 hardware found.\n");
+            queuePause(1000);
+            // First disable all NMEA messages in RAM layer
+            queueUBX(0x06, 0x8A, _message_VALSET_DISABLE_NMEA_RAM, sizeof(_message_VALSET_DISABLE_NMEA_RAM), 300, 250,
+                     "Unable to disable NMEA messages for M10 GPS RAM.");
+            // Next disable unwanted NMEA messages in BBR layer
+            queueUBX(0x06, 0x8A, _message_VALSET_DISABLE_NMEA_BBR, sizeof(_message_VALSET_DISABLE_NMEA_BBR), 300, 250,
+                     "Unable to disable NMEA messages for M10 GPS BBR.");
+            // Disable Info txt messages in RAM layer
+            queueUBX(0x06, 0x8A, _message_VALSET_DISABLE_TXT_INFO_RAM, sizeof(_message_VALSET_DISABLE_TXT_INFO_RAM), 300, 250,
+                     "Unable to disable Info messages for M10 GPS RAM.");
+            // Next disable Info txt messages in BBR layer
+            queueUBX(0x06, 0x8A, _message_VALSET_DISABLE_TXT_INFO_BBR, sizeof(_message_VALSET_DISABLE_TXT_INFO_BBR), 300, 0,
+                     "Unable to disable Info messages for M10 GPS BBR.");
+            // Do M10 configuration for Power Management.
+            queueUBX(0x06, 0x8A, _message_VALSET_PM_RAM, sizeof(_message_VALSET_PM_RAM), 300, 0,
+                     "Unable to enable powersaving for M10 GPS RAM.");
+            queueUBX(0x06, 0x8A, _message_VALSET_PM_BBR, sizeof(_message_VALSET_PM_BBR), 300, 250,
+                     "Unable to enable powersaving for M10 GPS BBR.");
+            queueUBX(0x06, 0x8A, _message_VALSET_ITFM_RAM, sizeof(_message_VALSET_ITFM_RAM), 300, 0,
+                     "Unable to enable Jamming detection M10 GPS RAM.");
+            queueUBX(0x06, 0x8A, _message_VALSET_ITFM_BBR, sizeof(_message_VALSET_ITFM_BBR), 300, 250,
+                     "Unable to enable Jamming detection M10 GPS BBR.");
+            // Here is where the init commands should go to do further M10 initialization.
+            // Disabling SBAS will cause a receiver restart so wait a bit
+            queueUBX(0x06, 0x8A, _message_VALSET_DISABLE_SBAS_RAM, sizeof(_message_VALSET_DISABLE_SBAS_RAM), 300, 750,
+                     "Unable to disable SBAS M10 GPS RAM.");
+            queueUBX(0x06, 0x8A, _message_VALSET_DISABLE_SBAS_BBR, sizeof(_message_VALSET_DISABLE_SBAS_BBR), 300, 750,
+                     "Unable to disable SBAS M10 GPS BBR.");
+            // Done with initialization, Now enable wanted NMEA messages in BBR layer so they will survive a periodic sleep.
+            queueUBX(0x06, 0x8A, _message_VALSET_ENABLE_NMEA_BBR, sizeof(_message_VALSET_ENABLE_NMEA_BBR), 300, 250,
+                     "Unable to enable messages for M10 GPS BBR.");
+            // Next enable wanted NMEA messages in RAM layer
+            queueUBX(0x06, 0x8A, _message_VALSET_ENABLE_NMEA_RAM, sizeof(_message_VALSET_ENABLE_NMEA_RAM), 300, 0,
+                     "Unable to enable messages for M10 GPS RAM.");
+            // As the M10 has no flash, the best we can do to preserve the config is to set it in RAM and BBR.
+            // BBR will survive a restart, and power off for a while, but modules with small backup
+            // batteries or super caps will not retain the config for a long power off time.
         }
-        didSerialInit = true;
+        // Checked by setup() once everything is done
+        queueUBX(0x06, 0x09, _message_SAVE, sizeof(_message_SAVE), 2000);
     }
-
-    notifyDeepSleepObserver.observe(&notifyDeepSleep);
-
-    return true;
 }
 
 GPS::~GPS()
 {
     // we really should unregister our sleep observer
     notifyDeepSleepObserver.unobserve(&notifyDeepSleep);
+    delete[] replyBuffer;
 }
 
 // Put the GPS hardware into a specified state
@@ -1048,8 +971,9 @@ int32_t GPS::runOnce()
             LOG_INFO("GPS set to not-present. Skipping probe.\n");
             return disable();
         }
-        if (!setup())
-            return 2000; // Setup failed, re-run in two seconds
+        int32_t setupWait = setup();
+        if (setupWait)
+            return setupWait; // Still probing or configuring the GPS (or the probe failed, and we retry in two seconds)
 
         // We have now loaded our saved preferences from flash
         if (config.position.gps_mode != meshtastic_Config_PositionConfig_GpsMode_ENABLED) {
@@ -1158,163 +1082,59 @@ int GPS::prepareDeepSleep(void *unused)
     return 0;
 }
 
-GnssModel_t GPS::probe(int serialSpeed)
+// Fill in info (and uBloxProtocolVersion) from a UBX-MON-VER payload
+void GPS::parseMonVer(const uint8_t *buffer, uint16_t len)
 {
-#if defined(ARCH_NRF52) || defined(ARCH_PORTDUINO) || defined(ARCH_RP2040)
-    _serial_gps->end();
-    _serial_gps->begin(serialSpeed);
-#else
-    if (_serial_gps->baudRate() != serialSpeed) {
-        LOG_DEBUG("Setting Baud to %i\n", serialSpeed);
-        _serial_gps->updateBaudRate(serialSpeed);
-    }
-#endif
-#ifdef GPS_DEBUG
-    for (int i = 0; i < 20; i++) {
-        getACK("$GP", 200);
-    }
-#endif
-    memset(&info, 0, sizeof(struct uBloxGnssModelInfo));
-    uint8_t buffer[768] = {0};
-    delay(100);
-
-    // Close all NMEA sentences, valid for L76K, ATGM336H (and likely other AT6558 devices)
-    _serial_gps->write("$PCAS03,0,0,0,0,0,0,0,0,0,0,,,0,0*02\r\n");
-    delay(20);
-
-    // Get version information
-    clearBuffer();
-    _serial_gps->write("$PCAS06,1*1A\r\n");
-    if (getACK("$GPTXT,01,01,02,HW=ATGM336H", 500) == GNSS_RESPONSE_OK) {
-        LOG_INFO("ATGM336H GNSS init succeeded, using ATGM336H Module\n");
-        return GNSS_MODEL_ATGM336H;
-    }
-
-    // Get version information
-    clearBuffer();
-    _serial_gps->write("$PCAS06,0*1B\r\n");
-    if (getACK("$GPTXT,01,01,02,SW=", 500) == GNSS_RESPONSE_OK) {
-        LOG_INFO("L76K GNSS init succeeded, using L76K GNSS Module\n");
-        return GNSS_MODEL_MTK;
-    }
-
-    // Close all NMEA sentences, valid for L76B MTK platform (Waveshare Pico GPS)
-    _serial_gps->write("$PMTK514,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*2E\r\n");
-    delay(20);
-
-    // Get version information
-    clearBuffer();
-    _serial_gps->write("$PMTK605*31\r\n");
-    if (getACK("Quectel-L76B", 500) == GNSS_RESPONSE_OK) {
-        LOG_INFO("L76B GNSS init succeeded, using L76B GNSS Module\n");
-        return GNSS_MODEL_MTK_L76B;
-    }
+    char value[32] = {0};
+
+    // LOG_DEBUG("monver reply size = %d\n", len);
+    // The fields are fixed width and NUL padded, take only what the reply really has of each and always terminate them
+    uint16_t position = 0;
+    auto copyField = [&](char *field, uint16_t size) {
+        for (uint16_t i = 0; i < size; i++, position++)
+            field[i] = (position < len) ? buffer[position] : '\0';
+        field[size - 1] = '\0';
+    };
+    copyField(info.swVersion, sizeof(info.swVersion));
+    copyField(info.hwVersion, sizeof(info.hwVersion));
 
-    uint8_t cfg_rate[] = {0xB5, 0x62, 0x06, 0x08, 0x00, 0x00, 0x00, 0x00};
-    UBXChecksum(cfg_rate, sizeof(cfg_rate));
-    clearBuffer();
-    _serial_gps->write(cfg_rate, sizeof(cfg_rate));
-    // Check that the returned response class and message ID are correct
-    GPS_RESPONSE response = getACK(0x06, 0x08, 750);
-    if (response == GNSS_RESPONSE_NONE) {
-        LOG_WARN("Failed to find UBlox & MTK GNSS Module using baudrate %d\n", serialSpeed);
-        return GNSS_MODEL_UNKNOWN;
-    } else if (response == GNSS_RESPONSE_FRAME_ERRORS) {
-        LOG_INFO("UBlox Frame Errors using baudrate %d\n", serialSpeed);
-    } else if (response == GNSS_RESPONSE_OK) {
-        LOG_INFO("Found a UBlox Module using baudrate %d\n", serialSpeed);
+    const uint8_t maxExtensions = sizeof(info.extension) / sizeof(info.extension[0]);
+    while (info.extensionNo < maxExtensions && len >= position + sizeof(info.extension[0])) {
+        copyField(info.extension[info.extensionNo], sizeof(info.extension[0]));
+        info.extensionNo++;
     }
 
-    // tips: NMEA Only should not be set here, otherwise initializing Ublox gnss module again after
-    // setting will not output command messages in UART1, resulting in unrecognized module information
-    if (serialSpeed != 9600) {
-        // Set the UART port to 9600
-        uint8_t _message_prt[] = {0xB5, 0x62, 0x06, 0x00, 0x14, 0x00, 0x01, 0x00, 0x00, 0x00, 0xD0, 0x08, 0x00, 0x00,
-                                  0x80, 0x25, 0x00, 0x00, 0x07, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-        UBXChecksum(_message_prt, sizeof(_message_prt));
-        _serial_gps->write(_message_prt, sizeof(_message_prt));
-        delay(500);
-        serialSpeed = 9600;
-#if defined(ARCH_NRF52) || defined(ARCH_PORTDUINO) || defined(ARCH_RP2040)
-        _serial_gps->end();
-        _serial_gps->begin(serialSpeed);
-#else
-        _serial_gps->updateBaudRate(serialSpeed);
-#endif
-        delay(200);
+    LOG_DEBUG("Module Info : \n");
+    LOG_DEBUG("Soft version: %s\n", info.swVersion);
+    LOG_DEBUG("Hard version: %s\n", info.hwVersion);
+    LOG_DEBUG("Extensions:%d\n", info.extensionNo);
+    for (int i = 0; i < info.extensionNo; i++) {
+        LOG_DEBUG("  %s\n", info.extension[i]);
     }
 
-    memset(buffer, 0, sizeof(buffer));
-    uint8_t _message_MONVER[8] = {
-        0xB5, 0x62, // Sync message for UBX protocol
-        0x0A, 0x04, // Message class and ID (UBX-MON-VER)
-        0x00, 0x00, // Length of payload (we're asking for an answer, so no payload)
-        0x00, 0x00  // Checksum
-    };
-    //  Get Ublox gnss module hardware and software info
-    UBXChecksum(_message_MONVER, sizeof(_message_MONVER));
-    clearBuffer();
-    _serial_gps->write(_message_MONVER, sizeof(_message_MONVER));
-
-    uint16_t len = getACK(buffer, sizeof(buffer), 0x0A, 0x04, 1200);
-    if (len) {
-        // LOG_DEBUG("monver reply size = %d\n", len);
-        uint16_t position = 0;
-        for (int i = 0; i < 30; i++) {
-            info.swVersion[i] = buffer[position];
-            position++;
-        }
-        for (int i = 0; i < 10; i++) {
-            info.hwVersion[i] = buffer[position];
-            position++;
-        }
-
-        while (len >= position + 30) {
-            for (int i = 0; i < 30; i++) {
-                info.extension[info.extensionNo][i] = buffer[position];
-                position++;
+    // tips: extensionNo field is 0 on some 6M GNSS modules
+    for (int i = 0; i < info.extensionNo; ++i) {
+        if (!strncmp(info.extension[i], "MOD=", 4)) {
+            strncpy(value, &(info.extension[i][4]), sizeof(value) - 1);
+            // LOG_DEBUG("GetModel:%s\n", value);
+            if (strlen(value)) {
+                LOG_INFO("UBlox GNSS probe succeeded, using UBlox %s GNSS Module\n", value);
+            } else {
+                LOG_INFO("UBlox GNSS probe succeeded, using UBlox GNSS Module\n");
             }
-            info.extensionNo++;
-            if (info.extensionNo > 9)
-                break;
-        }
-
-        LOG_DEBUG("Module Info : \n");
-        LOG_DEBUG("Soft version: %s\n", info.swVersion);
-        LOG_DEBUG("Hard version: %s\n", info.hwVersion);
-        LOG_DEBUG("Extensions:%d\n", info.extensionNo);
-        for (int i = 0; i < info.extensionNo; i++) {
-            LOG_DEBUG("  %s\n", info.extension[i]);
-        }
-
-        memset(buffer, 0, sizeof(buffer));
-
-        // tips: extensionNo field is 0 on some 6M GNSS modules
-        for (int i = 0; i < info.extensionNo; ++i) {
-            if (!strncmp(info.extension[i], "MOD=", 4)) {
-                strncpy((char *)buffer, &(info.extension[i][4]), sizeof(buffer));
-                // LOG_DEBUG("GetModel:%s\n", (char *)buffer);
-                if (strlen((char *)buffer)) {
-                    LOG_INFO("UBlox GNSS probe succeeded, using UBlox %s GNSS Module\n", (char *)buffer);
-                } else {
-                    LOG_INFO("UBlox GNSS probe succeeded, using UBlox GNSS Module\n");
-                }
-            } else if (!strncmp(info.extension[i], "PROTVER", 7)) {
-                char *ptr = nullptr;
-                memset(buffer, 0, sizeof(buffer));
-                strncpy((char *)buffer, &(info.extension[i][8]), sizeof(buffer));
-                LOG_DEBUG("Protocol Version:%s\n", (char *)buffer);
-                if (strlen((char *)buffer)) {
-                    uBloxProtocolVersion = strtoul((char *)buffer, &ptr, 10);
-                    LOG_DEBUG("ProtVer=%d\n", uBloxProtocolVersion);
-                } else {
-                    uBloxProtocolVersion = 0;
-                }
+        } else if (!strncmp(info.extension[i], "PROTVER", 7)) {
+            char *ptr = nullptr;
+            memset(value, 0, sizeof(value));
+            strncpy(value, &(info.extension[i][8]), sizeof(value) - 1);
+            LOG_DEBUG("Protocol Version:%s\n", value);
+            if (strlen(value)) {
+                uBloxProtocolVersion = strtoul(value, &ptr, 10);
+                LOG_DEBUG("ProtVer=%d\n", uBloxProtocolVersion);
+            } else {
+                uBloxProtocolVersion = 0;
             }
         }
     }
-
-    return GNSS_MODEL_UBLOX;
 }
 
 GPS *GPS::createGps()
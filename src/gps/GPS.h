@@ -2,6 +2,7 @@
 #include "configuration.h"
 #if !MESHTASTIC_EXCLUDE_GPS
 
+#include "GPSCommand.h"
 #include "GPSStatus.h"
 #include "Observer.h"
 #include "TinyGPS++.h"
@@ -15,6 +16,16 @@
 #define GPS_EN_ACTIVE 1
 #endif
 
+/// The most GNSS setup commands we queue at once (the u-blox configurations are the longest)
+#ifndef GPS_MAX_COMMANDS
+#define GPS_MAX_COMMANDS 16
+#endif
+
+/// How often (in msecs) we look for the reply to a setup command, 9600 baud brings in about 20 bytes in that time
+#ifndef GPS_COMMAND_POLL_MSEC
+#define GPS_COMMAND_POLL_MSEC 20
+#endif
+
 struct uBloxGnssModelInfo {
     char swVersion[30];
     char hwVersion[10];
@@ -31,13 +42,6 @@ typedef enum {
     GNSS_MODEL_MTK_L76B
 } GnssModel_t;
 
-typedef enum {
-    GNSS_RESPONSE_NONE,
-    GNSS_RESPONSE_NAK,
-    GNSS_RESPONSE_FRAME_ERRORS,
-    GNSS_RESPONSE_OK,
-} GPS_RESPONSE;
-
 enum GPSPowerState : uint8_t {
     GPS_ACTIVE,    // Awake and want a position
     GPS_IDLE,      // Awake, but not wanting another position yet
@@ -46,6 +50,20 @@ enum GPSPowerState : uint8_t {
     GPS_OFF        // Powered off indefinitely
 };
 
+// Where GPS::setup() is in bringing up the receiver
+enum GPSSetupStage : uint8_t {
+    GPS_SETUP_PROBE,               // Start probing at serialSpeeds[speedSelect]
+    GPS_SETUP_PROBE_ATGM336H,      // Asked for the CASIC hardware version
+    GPS_SETUP_PROBE_L76K,          // Asked for the CASIC software version
+    GPS_SETUP_PROBE_L76B,          // Asked for the Quectel version
+    GPS_SETUP_PROBE_UBLOX,         // Sent a UBX-CFG-RATE poll
+    GPS_SETUP_PROBE_UBLOX_BAUD,    // Told the u-blox to switch to 9600 baud
+    GPS_SETUP_PROBE_UBLOX_VERSION, // Asked for UBX-MON-VER
+    GPS_SETUP_CONFIGURE,           // gnssModel is known, send its configuration
+    GPS_SETUP_CONFIGURING,         // Waiting for that to be done
+    GPS_SETUP_DONE
+};
+
 // Generate a string representation of DOP
 const char *getDOPString(uint32_t dop);
 
@@ -96,6 +114,20 @@ class GPS : private concurrency::OSThread
 
     uint8_t numSatellites = 0;
 
+    // GNSS setup, one command at a time (see runCommands())
+    GPSSetupStage setupStage = GPS_SETUP_PROBE;
+    GPSCommand commands[GPS_MAX_COMMANDS];
+    uint8_t numCommands = 0;
+    uint8_t nextCommand = 0;                        // The one we are sending, or waiting for the reply to
+    bool awaitingReply = false;                     // commands[nextCommand] has been sent
+    uint32_t commandSentMsec = 0;                   // When it was sent
+    uint32_t readyMsec = 0;                         // When the receiver will be ready for the next command
+    GPS_RESPONSE lastResponse = GNSS_RESPONSE_NONE; // The reply to the last command that finished
+    GPSReplyMatcher replyMatcher;
+    uint8_t *replyBuffer = NULL;  // UBX message payloads, only allocated while we ask a u-blox for its version
+    uint32_t setupStartMsec = 0;  // When we started probing, for the setup log
+    uint16_t numCommandsSent = 0; // Commands sent since then
+
     CallbackObserver<GPS, void *> notifyDeepSleepObserver = CallbackObserver<GPS, void *>(this, &GPS::prepareDeepSleep);
 
   public:
@@ -128,6 +160,7 @@ class GPS : private concurrency::OSThread
     static const uint8_t _message_GGA[];
     static const uint8_t _message_PMS[];
     static const uint8_t _message_SAVE[];
+    static const uint8_t _message_PRT_9600[];
 
     // VALSET Commands for M10
     static const uint8_t _message_VALSET_PM[];
@@ -148,6 +181,8 @@ class GPS : private concurrency::OSThread
     static const uint8_t _message_CAS_CFG_RST_FACTORY[];
     static const uint8_t _message_CAS_CFG_NAVX_CONF[];
     static const uint8_t _message_CAS_CFG_RATE_1HZ[];
+    static const uint8_t _message_CAS_CFG_MSG_RMC[];
+    static const uint8_t _message_CAS_CFG_MSG_GGA[];
 
     meshtastic_Position p = meshtastic_Position_init_default;
 
@@ -159,9 +194,12 @@ class GPS : private concurrency::OSThread
     Observable<const meshtastic::GPSStatus *> newStatus;
 
     /**
-     * Returns true if we succeeded
+     * Probe for and configure the receiver, a step at a time: each call sends the next command and returns rather than
+     * waiting for the reply, so the rest of the firmware keeps running while the receiver takes its time.
+     *
+     * @return 0 once finished, otherwise the msecs until we want to be called again
      */
-    virtual bool setup();
+    virtual int32_t setup();
 
     // re-enable the thread
     void enable();
@@ -198,11 +236,10 @@ class GPS : private concurrency::OSThread
 
     int rebootsSeen = 0;
 
-    int getACK(uint8_t *buffer, uint16_t size, uint8_t requestedClass, uint8_t requestedID, uint32_t waitMillis);
+    // Wait (blocking) for a reply, only for the rare commands that are not worth queueing (see setup())
     GPS_RESPONSE getACK(uint8_t c, uint8_t i, uint32_t waitMillis);
     GPS_RESPONSE getACK(const char *message, uint32_t waitMillis);
-
-    GPS_RESPONSE getACKCas(uint8_t class_id, uint8_t msg_id, uint32_t waitMillis);
+    GPS_RESPONSE waitForReply(GPSReplyMatcher &matcher, uint32_t waitMillis);
 
     virtual bool factoryReset();
 
@@ -290,7 +327,31 @@ class GPS : private concurrency::OSThread
 
     // Get GNSS model
     String getNMEA();
-    GnssModel_t probe(int serialSpeed);
+    void setSerialSpeed(int serialSpeed);
+    void parseMonVer(const uint8_t *buffer, uint16_t len);
+
+    // Queue the commands that configure gnssModel
+    void queueConfiguration();
+
+    // Queue a setup command, sent once the ones before it are done
+    void queueNMEA(const char *sentence, uint16_t settleMsec);
+    void queueNMEA(const char *sentence, const char *expect, uint16_t timeoutMsec);
+    void queueUBX(uint8_t classId, uint8_t msgId, const uint8_t *payload, uint8_t size, uint16_t timeoutMsec,
+                  uint16_t settleMsec = 0, const char *failure = NULL);
+    void queueUBXPoll(uint8_t classId, uint8_t msgId, uint16_t timeoutMsec);
+    void queueCAS(uint8_t classId, uint8_t msgId, const uint8_t *payload, uint8_t size, uint16_t timeoutMsec,
+                  const char *failure);
+    void queuePause(uint16_t msec);
+    GPSCommand *queueCommand(GPSCommand::Type type, GPSCommand::Reply reply);
+
+    /**
+     * Send the queued commands and collect their replies, without waiting for any of them
+     *
+     * @return 0 once the queue is empty and the receiver is ready for more, otherwise the msecs until we should call again
+     */
+    int32_t runCommands();
+    void sendCommand(const GPSCommand &command);
+    void finishCommand(GPS_RESPONSE response);
 
     // delay counter to allow more sats before fixed position stops GPS thread
     uint8_t fixeddelayCtr = 0;
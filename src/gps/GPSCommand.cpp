@@ -0,0 +1,175 @@
+#include "GPSCommand.h"
+#include <string.h>
+
+// What a u-blox receiver prints when it can't understand us, usually because we are at the wrong baud rate
+static const char frameErrors[] = "More than 100 frame errors";
+
+void GPSReplyMatcher::begin(const GPSCommand &command, uint8_t *buffer, uint16_t bufferSize)
+{
+    reply = command.reply;
+    classId = command.classId;
+    msgId = command.msgId;
+    text = command.expect;
+    this->buffer = buffer;
+    this->bufferSize = bufferSize;
+    framePos = needRead = 0;
+    textPos = frameErrorPos = 0;
+}
+
+void GPSReplyMatcher::beginUBXAck(uint8_t classId, uint8_t msgId)
+{
+    GPSCommand command = {};
+    command.reply = GPSCommand::UBX_ACK;
+    command.classId = classId;
+    command.msgId = msgId;
+    begin(command);
+}
+
+void GPSReplyMatcher::beginText(const char *text)
+{
+    GPSCommand command = {};
+    command.reply = GPSCommand::TEXT;
+    command.expect = text;
+    begin(command);
+}
+
+GPS_RESPONSE GPSReplyMatcher::feed(uint8_t c)
+{
+    switch (reply) {
+    case GPSCommand::UBX_ACK:
+        if (matchText(frameErrors, frameErrorPos, c))
+            return GNSS_RESPONSE_FRAME_ERRORS;
+        return feedUBXAck(c);
+    case GPSCommand::CAS_ACK:
+        return feedCASAck(c);
+    case GPSCommand::TEXT:
+        return matchText(text, textPos, c) ? GNSS_RESPONSE_OK : GNSS_RESPONSE_NONE;
+    case GPSCommand::UBX_MESSAGE:
+        return feedUBXMessage(c);
+    default:
+        return GNSS_RESPONSE_NONE;
+    }
+}
+
+GPS_RESPONSE GPSReplyMatcher::feedUBXAck(uint8_t c)
+{
+    // UBX-ACK-(N)ACK: | 0xB5 | 0x62 | 0x05 | 0x00 NAK, 0x01 ACK | 0x02 | 0x00 | class | id | CK_A | CK_B |
+    static const uint8_t header[] = {0xB5, 0x62, 0x05, 0x01, 0x02, 0x00};
+
+    if (framePos < sizeof(header)) {
+        bool matches = (framePos == 3) ? (c == 0x00 || c == 0x01) : (c == header[framePos]);
+        if (!matches) {
+            framePos = 0;
+            if (c != header[0])
+                return GNSS_RESPONSE_NONE;
+        }
+        frame[framePos++] = c;
+        return GNSS_RESPONSE_NONE;
+    }
+
+    frame[framePos++] = c;
+    if (framePos < 10)
+        return GNSS_RESPONSE_NONE;
+    framePos = 0;
+
+    uint8_t CK_A = 0, CK_B = 0;
+    for (int i = 2; i < 8; i++) {
+        CK_A += frame[i];
+        CK_B += CK_A;
+    }
+    if (frame[6] != classId || frame[7] != msgId || frame[8] != CK_A || frame[9] != CK_B)
+        return GNSS_RESPONSE_NONE; // Someone else's (N)ACK, or garbled
+    return frame[3] ? GNSS_RESPONSE_OK : GNSS_RESPONSE_NAK;
+}
+
+GPS_RESPONSE GPSReplyMatcher::feedCASAck(uint8_t c)
+{
+    // CAS-ACK-(N)ACK structure
+    //         | H1   | H2   | Payload Len | cls  | msg  | Payload                   | Checksum (4)              |
+    //         |      |      |             |      |      | Cls  | Msg  | Reserved    |                           |
+    //         |------|------|-------------|------|------|------|------|-------------|---------------------------|
+    // ACK-NACK| 0xBA | 0xCE | 0x04 | 0x00 | 0x05 | 0x00 | 0xXX | 0xXX | 0x00 | 0x00 | 0xXX | 0xXX | 0xXX | 0xXX |
+    // ACK-ACK | 0xBA | 0xCE | 0x04 | 0x00 | 0x05 | 0x01 | 0xXX | 0xXX | 0x00 | 0x00 | 0xXX | 0xXX | 0xXX | 0xXX |
+    static const uint8_t header[] = {0xBA, 0xCE, 0x04, 0x00, 0x05, 0x01};
+
+    if (framePos < sizeof(header)) {
+        bool matches = (framePos == 5) ? (c == 0x00 || c == 0x01) : (c == header[framePos]);
+        if (!matches) {
+            framePos = 0;
+            if (c != header[0])
+                return GNSS_RESPONSE_NONE;
+        }
+        frame[framePos++] = c;
+        return GNSS_RESPONSE_NONE;
+    }
+
+    frame[framePos++] = c;
+    if (framePos < sizeof(frame))
+        return GNSS_RESPONSE_NONE;
+    framePos = 0;
+
+    if (frame[6] != classId || frame[7] != msgId)
+        return GNSS_RESPONSE_NONE;
+    return frame[5] ? GNSS_RESPONSE_OK : GNSS_RESPONSE_NAK;
+}
+
+GPS_RESPONSE GPSReplyMatcher::feedUBXMessage(uint8_t c)
+{
+    // | 0xB5 | 0x62 | class | id | length (LE) | payload ... | CK_A | CK_B |, we are done once we have the payload
+    switch (framePos) {
+    case 0:
+        if (c == 0xB5)
+            framePos++;
+        return GNSS_RESPONSE_NONE;
+    case 1:
+        framePos = (c == 0x62) ? 2 : (c == 0xB5 ? 1 : 0);
+        return GNSS_RESPONSE_NONE;
+    case 2:
+        framePos = (c == classId) ? 3 : (c == 0xB5 ? 1 : 0);
+        return GNSS_RESPONSE_NONE;
+    case 3:
+        framePos = (c == msgId) ? 4 : (c == 0xB5 ? 1 : 0);
+        return GNSS_RESPONSE_NONE;
+    case 4:
+        needRead = c;
+        framePos++;
+        return GNSS_RESPONSE_NONE;
+    case 5:
+        needRead |= (c << 8);
+        framePos++;
+        if (needRead >= bufferSize) { // Won't fit, keep looking
+            framePos = needRead = 0;
+        } else if (needRead == 0) {
+            framePos = 0;
+            return GNSS_RESPONSE_OK;
+        }
+        return GNSS_RESPONSE_NONE;
+    default:
+        buffer[framePos++ - 6] = c;
+        if (framePos - 6 < needRead)
+            return GNSS_RESPONSE_NONE;
+        framePos = 0;
+        return GNSS_RESPONSE_OK;
+    }
+}
+
+bool GPSReplyMatcher::matchText(const char *s, uint8_t &pos, uint8_t c)
+{
+    for (;;) {
+        if (s[pos] == c) {
+            if (s[++pos])
+                return false;
+            pos = 0;
+            return true;
+        }
+        if (pos == 0)
+            return false;
+
+        // Fall back to the longest part of what we matched that is also the start of s, then try c again.  The texts we
+        // look for are short, so brute force is fine
+        uint8_t k = pos - 1;
+        while (k > 0 && strncmp(s, s + pos - k, k) != 0)
+            k--;
+        pos = k;
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    GNSS_RESPONSE_NONE,
+    GNSS_RESPONSE_NAK,
+    GNSS_RESPONSE_FRAME_ERRORS,
+    GNSS_RESPONSE_OK,
+} GPS_RESPONSE;
+
+/**
+ * One step of bringing up a GNSS receiver: a command to send, the reply to wait for, and how long the receiver needs
+ * before it will take the next one.
+ *
+ * GPS queues these and sends them one at a time from its thread, collecting each reply as the bytes arrive, so the
+ * seconds a receiver can take to answer are spent running the rest of the firmware rather than in delay().
+ */
+struct GPSCommand {
+    enum Type : uint8_t {
+        NMEA,  // send the sentence as is
+        UBX,   // send classId/msgId with the payload as a UBX frame
+        CAS,   // send classId/msgId with the payload as a CASIC frame
+        PAUSE, // send nothing, just wait settleMsec
+    };
+
+    enum Reply : uint8_t {
+        NO_REPLY,    // the receiver doesn't answer this one
+        UBX_ACK,     // UBX-ACK-ACK/NAK for classId/msgId
+        CAS_ACK,     // CASIC ACK-ACK/NAK for classId/msgId
+        TEXT,        // some line containing expect
+        UBX_MESSAGE, // a UBX classId/msgId frame, its payload is kept
+    };
+
+    Type type;
+    Reply reply;
+    uint8_t classId, msgId; // UBX/CAS frame, also what the reply has to match
+    uint8_t size;           // payload size
+    const uint8_t *payload; // UBX/CAS payload (may be in PROGMEM)
+    const char *sentence;   // NMEA sentence, including the checksum and CR LF
+    const char *expect;     // TEXT to look for in the reply
+    uint16_t timeoutMsec;   // how long we wait for the reply
+    uint16_t settleMsec;    // how long the receiver needs after this command (skipped if it NAKed)
+    const char *failure;    // logged as a warning if we don't get an OK, NULL if the caller checks the result itself
+};
+
+/**
+ * Recognises the reply to a GPSCommand in the bytes the receiver sends, which are mostly NMEA sentences we don't care about.
+ *
+ * Bytes are fed one at a time as they arrive, so a reply can be spread over any number of calls.
+ */
+class GPSReplyMatcher
+{
+  public:
+    /// Start looking for the reply to command, UBX_MESSAGE payloads are stored in buffer
+    void begin(const GPSCommand &command, uint8_t *buffer = NULL, uint16_t bufferSize = 0);
+
+    /// Look for the reply to a UBX command
+    void beginUBXAck(uint8_t classId, uint8_t msgId);
+
+    /// Look for a line containing text
+    void beginText(const char *text);
+
+    /// @return GNSS_RESPONSE_NONE until c completes the reply (or a sign the receiver can't answer)
+    GPS_RESPONSE feed(uint8_t c);
+
+    /// The payload length of the UBX_MESSAGE we got
+    uint16_t getLength() const { return needRead; }
+
+  private:
+    GPSCommand::Reply reply = GPSCommand::NO_REPLY;
+    uint8_t classId = 0, msgId = 0;
+    const char *text = NULL;
+    uint8_t *buffer = NULL;
+    uint16_t bufferSize = 0;
+
+    uint8_t frame[14];         // the (N)ACK we are collecting
+    uint16_t framePos = 0;     // bytes of the current frame we have so far
+    uint16_t needRead = 0;     // UBX_MESSAGE payload length
+    uint8_t textPos = 0;       // chars of text matched so far
+    uint8_t frameErrorPos = 0; // chars of the u-blox frame errors warning matched so far
+
+    GPS_RESPONSE feedUBXAck(uint8_t c);
+    GPS_RESPONSE feedCASAck(uint8_t c);
+    GPS_RESPONSE feedUBXMessage(uint8_t c);
+
+    /// Advance pos through the NUL terminated s, @return true once it is all matched
+    static bool matchText(const char *s, uint8_t &pos, uint8_t c);
+};
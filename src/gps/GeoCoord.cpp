@@ -1,21 +1,14 @@
 #include "GeoCoord.h"
 
-GeoCoord::GeoCoord()
-{
-    _dirty = true;
-}
+GeoCoord::GeoCoord() {}
 
-GeoCoord::GeoCoord(int32_t lat, int32_t lon, int32_t alt) : _latitude(lat), _longitude(lon), _altitude(alt)
-{
-    GeoCoord::setCoords();
-}
+GeoCoord::GeoCoord(int32_t lat, int32_t lon, int32_t alt) : _latitude(lat), _longitude(lon), _altitude(alt) {}
 
 GeoCoord::GeoCoord(float lat, float lon, int32_t alt) : _altitude(alt)
 {
     // Change decimial representation to int32_t. I.e., 12.345 becomes 123450000
     _latitude = int32_t(lat * 1e+7);
     _longitude = int32_t(lon * 1e+7);
-    GeoCoord::setCoords();
 }
 
 GeoCoord::GeoCoord(double lat, double lon, int32_t alt) : _altitude(alt)
@@ -23,60 +16,72 @@ GeoCoord::GeoCoord(double lat, double lon, int32_t alt) : _altitude(alt)
     // Change decimial representation to int32_t. I.e., 12.345 becomes 123450000
     _latitude = int32_t(lat * 1e+7);
     _longitude = int32_t(lon * 1e+7);
-    GeoCoord::setCoords();
 }
 
-// Initialize all the coordinate systems
-void GeoCoord::setCoords()
+// Each of these converts the current coordinates the first time that representation is needed
+const DMS &GeoCoord::dms() const
 {
-    double lat = _latitude * 1e-7;
-    double lon = _longitude * 1e-7;
-    GeoCoord::latLongToDMS(lat, lon, _dms);
-    GeoCoord::latLongToUTM(lat, lon, _utm);
-    GeoCoord::latLongToMGRS(lat, lon, _mgrs);
-    GeoCoord::latLongToOSGR(lat, lon, _osgr);
-    GeoCoord::latLongToOLC(lat, lon, _olc);
-    _dirty = false;
+    if (!isValid(FORMAT_DMS)) {
+        latLongToDMS(_latitude * 1e-7, _longitude * 1e-7, _dms);
+        _valid |= FORMAT_DMS;
+    }
+    return _dms;
 }
 
-void GeoCoord::updateCoords(int32_t lat, int32_t lon, int32_t alt)
+const UTM &GeoCoord::utm() const
 {
-    // If marked dirty or new coordinates
-    if (_dirty || _latitude != lat || _longitude != lon || _altitude != alt) {
-        _dirty = true;
-        _latitude = lat;
-        _longitude = lon;
-        _altitude = alt;
-        setCoords();
+    if (!isValid(FORMAT_UTM)) {
+        latLongToUTM(_latitude * 1e-7, _longitude * 1e-7, _utm);
+        _valid |= FORMAT_UTM;
     }
+    return _utm;
 }
 
-void GeoCoord::updateCoords(const double lat, const double lon, const int32_t alt)
+const MGRS &GeoCoord::mgrs() const
 {
-    int32_t iLat = lat * 1e+7;
-    int32_t iLon = lon * 1e+7;
-    // If marked dirty or new coordinates
-    if (_dirty || _latitude != iLat || _longitude != iLon || _altitude != alt) {
-        _dirty = true;
-        _latitude = iLat;
-        _longitude = iLon;
-        _altitude = alt;
-        setCoords();
+    if (!isValid(FORMAT_MGRS)) {
+        latLongToMGRS(_latitude * 1e-7, _longitude * 1e-7, _mgrs);
+        _valid |= FORMAT_MGRS;
     }
+    return _mgrs;
 }
 
-void GeoCoord::updateCoords(const float lat, const float lon, const int32_t alt)
+const OSGR &GeoCoord::osgr() const
 {
-    int32_t iLat = lat * 1e+7;
-    int32_t iLon = lon * 1e+7;
-    // If marked dirty or new coordinates
-    if (_dirty || _latitude != iLat || _longitude != iLon || _altitude != alt) {
-        _dirty = true;
-        _latitude = iLat;
-        _longitude = iLon;
-        _altitude = alt;
-        setCoords();
+    if (!isValid(FORMAT_OSGR)) {
+        latLongToOSGR(_latitude * 1e-7, _longitude * 1e-7, _osgr);
+        _valid |= FORMAT_OSGR;
     }
+    return _osgr;
+}
+
+const OLC &GeoCoord::olc() const
+{
+    if (!isValid(FORMAT_OLC)) {
+        latLongToOLC(_latitude * 1e-7, _longitude * 1e-7, _olc);
+        _valid |= FORMAT_OLC;
+    }
+    return _olc;
+}
+
+void GeoCoord::updateCoords(int32_t lat, int32_t lon, int32_t alt)
+{
+    // Altitude isn't part of any of the representations, only new lat/lon need converting again
+    if (_latitude != lat || _longitude != lon)
+        _valid = 0;
+    _latitude = lat;
+    _longitude = lon;
+    _altitude = alt;
+}
+
+void GeoCoord::updateCoords(const double lat, const double lon, const int32_t alt)
+{
+    updateCoords(int32_t(lat * 1e+7), int32_t(lon * 1e+7), alt);
+}
+
+void GeoCoord::updateCoords(const float lat, const float lon, const int32_t alt)
+{
+    updateCoords(int32_t(lat * 1e+7), int32_t(lon * 1e+7), alt);
 }
 
 /**
@@ -574,3 +579,48 @@ const char *GeoCoord::degreesToBearing(uint degrees)
     else
         return "N";
 }
+
+GeoOrigin::GeoOrigin(int32_t lat, int32_t lon) : latitude(lat), longitude(lon)
+{
+    float latRad = lat * float(PI / 180 * 1e-7);
+    sinLat = sinf(latRad);
+    cosLat = cosf(latRad);
+}
+
+void GeoOrigin::distanceAndBearingTo(int32_t lat, int32_t lon, float &meters, float &bearing) const
+{
+    const float toRad = float(PI / 180 * 1e-7);
+
+    // Work from the differences in integer 1e-7 degrees, so nearby points don't lose their precision to float rounding
+    float dLat = float(int64_t(lat) - latitude) * toRad;
+    float dLon = float(int64_t(lon) - longitude) * toRad;
+    float cosLat2 = cosf(lat * toRad);
+    float sinHalfDLat = sinf(dLat / 2), sinHalfDLon = sinf(dLon / 2);
+
+    // Haversine, with the same earth radius as latLongToMeter()
+    float a = sinHalfDLat * sinHalfDLat + cosLat * cosLat2 * sinHalfDLon * sinHalfDLon;
+    meters = 2 * 6366000 * asinf(sqrtf(a < 1 ? a : 1));
+
+    // Same as bearing(), but with cos(lat1) sin(lat2) - sin(lat1) cos(lat2) cos(dLon) rewritten as
+    // sin(dLat) + 2 sin(lat1) cos(lat2) sin²(dLon / 2) so short distances don't cancel away in float
+    float x = sinf(dLat) + 2 * sinLat * cosLat2 * sinHalfDLon * sinHalfDLon;
+    bearing = atan2f(sinf(dLon) * cosLat2, x);
+}
+
+float GeoOrigin::distanceTo(int32_t lat, int32_t lon) const
+{
+    const float toRad = float(PI / 180 * 1e-7);
+
+    float dLat = float(int64_t(lat) - latitude) * toRad;
+    float dLon = float(int64_t(lon) - longitude) * toRad;
+    float sinHalfDLat = sinf(dLat / 2), sinHalfDLon = sinf(dLon / 2);
+    float a = sinHalfDLat * sinHalfDLat + cosLat * cosf(lat * toRad) * sinHalfDLon * sinHalfDLon;
+    return 2 * 6366000 * asinf(sqrtf(a < 1 ? a : 1));
+}
+
+float GeoOrigin::bearingTo(int32_t lat, int32_t lon) const
+{
+    float meters, bearing;
+    distanceAndBearingTo(lat, lon, meters, bearing);
+    return bearing;
+}
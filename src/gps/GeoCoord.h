@@ -86,15 +86,24 @@ class GeoCoord
     int32_t _longitude = 0;
     int32_t _altitude = 0;
 
-    DMS _dms = {};
-    UTM _utm = {};
-    MGRS _mgrs = {};
-    OSGR _osgr = {};
-    OLC _olc = {};
+    // Each representation is only converted the first time it is asked for after the coordinates change, so the screen
+    // (which shows just the one config.display.gps_format picks) doesn't pay for the other four on every GPS update
+    enum Format : uint8_t { FORMAT_DMS = 1, FORMAT_UTM = 2, FORMAT_MGRS = 4, FORMAT_OSGR = 8, FORMAT_OLC = 16 };
 
-    bool _dirty = true;
+    mutable DMS _dms = {};
+    mutable UTM _utm = {};
+    mutable MGRS _mgrs = {};
+    mutable OSGR _osgr = {};
+    mutable OLC _olc = {};
 
-    void setCoords();
+    mutable uint8_t _valid = 0; // Format bits of the representations that match the current coordinates
+
+    bool isValid(Format format) const { return _valid & format; }
+    const DMS &dms() const;
+    const UTM &utm() const;
+    const MGRS &mgrs() const;
+    const OSGR &osgr() const;
+    const OLC &olc() const;
 
   public:
     GeoCoord();
@@ -131,35 +140,66 @@ class GeoCoord
     int32_t getAltitude() const { return _altitude; }
 
     // DMS getters
-    uint8_t getDMSLatDeg() const { return _dms.latDeg; }
-    uint8_t getDMSLatMin() const { return _dms.latMin; }
-    uint32_t getDMSLatSec() const { return _dms.latSec; }
-    char getDMSLatCP() const { return _dms.latCP; }
-    uint8_t getDMSLonDeg() const { return _dms.lonDeg; }
-    uint8_t getDMSLonMin() const { return _dms.lonMin; }
-    uint32_t getDMSLonSec() const { return _dms.lonSec; }
-    char getDMSLonCP() const { return _dms.lonCP; }
+    uint8_t getDMSLatDeg() const { return dms().latDeg; }
+    uint8_t getDMSLatMin() const { return dms().latMin; }
+    uint32_t getDMSLatSec() const { return dms().latSec; }
+    char getDMSLatCP() const { return dms().latCP; }
+    uint8_t getDMSLonDeg() const { return dms().lonDeg; }
+    uint8_t getDMSLonMin() const { return dms().lonMin; }
+    uint32_t getDMSLonSec() const { return dms().lonSec; }
+    char getDMSLonCP() const { return dms().lonCP; }
 
     // UTM getters
-    uint8_t getUTMZone() const { return _utm.zone; }
-    char getUTMBand() const { return _utm.band; }
-    uint32_t getUTMEasting() const { return _utm.easting; }
-    uint32_t getUTMNorthing() const { return _utm.northing; }
+    uint8_t getUTMZone() const { return utm().zone; }
+    char getUTMBand() const { return utm().band; }
+    uint32_t getUTMEasting() const { return utm().easting; }
+    uint32_t getUTMNorthing() const { return utm().northing; }
 
     // MGRS getters
-    uint8_t getMGRSZone() const { return _mgrs.zone; }
-    char getMGRSBand() const { return _mgrs.band; }
-    char getMGRSEast100k() const { return _mgrs.east100k; }
-    char getMGRSNorth100k() const { return _mgrs.north100k; }
-    uint32_t getMGRSEasting() const { return _mgrs.easting; }
-    uint32_t getMGRSNorthing() const { return _mgrs.northing; }
+    uint8_t getMGRSZone() const { return mgrs().zone; }
+    char getMGRSBand() const { return mgrs().band; }
+    char getMGRSEast100k() const { return mgrs().east100k; }
+    char getMGRSNorth100k() const { return mgrs().north100k; }
+    uint32_t getMGRSEasting() const { return mgrs().easting; }
+    uint32_t getMGRSNorthing() const { return mgrs().northing; }
 
     // OSGR getters
-    char getOSGRE100k() const { return _osgr.e100k; }
-    char getOSGRN100k() const { return _osgr.n100k; }
-    uint32_t getOSGREasting() const { return _osgr.easting; }
-    uint32_t getOSGRNorthing() const { return _osgr.northing; }
+    char getOSGRE100k() const { return osgr().e100k; }
+    char getOSGRN100k() const { return osgr().n100k; }
+    uint32_t getOSGREasting() const { return osgr().easting; }
+    uint32_t getOSGRNorthing() const { return osgr().northing; }
 
     // OLC getter
-    void getOLCCode(char *code) { strncpy(code, _olc.code, OLC_CODE_LEN + 1); } // +1 for null termination
+    void getOLCCode(char *code) const { strncpy(code, olc().code, OLC_CODE_LEN + 1); } // +1 for null termination
+};
+
+/**
+ * Distances and bearings from one point (usually our own position) to others, in single precision.
+ *
+ * latLongToMeter() and bearing() work in double, which most of our MCUs only do in software, and redo all the trig for
+ * both points on every call.  Here the origin's trig is done once in the constructor, and each destination costs a few
+ * float sin/cos (haversine, so it stays accurate for nearby nodes), which is what you want when the same origin is used
+ * for every node on the screen or every range test packet.  Float is good to about a meter at these ranges.
+ */
+class GeoOrigin
+{
+  public:
+    /// Coordinates in 1e-7 degrees, as in our position protobufs
+    GeoOrigin(int32_t lat, int32_t lon);
+
+    int32_t getLatitude() const { return latitude; }
+    int32_t getLongitude() const { return longitude; }
+
+    /// Distance in meters along the globe surface from the origin to lat/lon (1e-7 degrees)
+    float distanceTo(int32_t lat, int32_t lon) const;
+
+    /// Bearing in radians from the origin to lat/lon (1e-7 degrees), 0 means due north
+    float bearingTo(int32_t lat, int32_t lon) const;
+
+    /// Both of the above, sharing the trig
+    void distanceAndBearingTo(int32_t lat, int32_t lon, float &meters, float &bearing) const;
+
+  private:
+    int32_t latitude, longitude;
+    float sinLat, cosLat;
 };
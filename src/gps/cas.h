@@ -35,6 +35,20 @@ const uint8_t GPS::_message_CAS_CFG_RATE_1HZ[] = {
     0x00, 0x00  // Reserved
 };
 
+// CFG-MSG (0x06, 0x01)
+// Output the NMEA RMC/GGA sentence once every fix
+const uint8_t GPS::_message_CAS_CFG_MSG_RMC[] = {
+    0x4e,         // Class: NMEA
+    CAS_NEMA_RMC, // Message ID
+    0x01, 0x00    // Output Rate: every fix
+};
+
+const uint8_t GPS::_message_CAS_CFG_MSG_GGA[] = {
+    0x4e,         // Class: NMEA
+    CAS_NEMA_GGA, // Message ID
+    0x01, 0x00    // Output Rate: every fix
+};
+
 // CFG-NAVX (0x06, 0x07)
 // Initial ATGM33H-5N configuration, Updates for Dynamic Mode, Fix Mode, and SV system
 // Qwirk: The ATGM33H-5N-31 should only support GPS+BDS, however it will happily enable
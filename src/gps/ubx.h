@@ -316,6 +316,19 @@ const uint8_t GPS::_message_SAVE[] = {
     0x17                    // deviceMask: BBR, Flash, EEPROM, and SPI Flash
 };
 
+// UBX-CFG-PRT: UART1 at 9600 baud, 8N1, UBX+NMEA+RTCM in, UBX+NMEA out
+const uint8_t GPS::_message_PRT_9600[] = {
+    0x01,                   // portID: UART1
+    0x00,                   // reserved0
+    0x00, 0x00,             // txReady: disabled
+    0xD0, 0x08, 0x00, 0x00, // mode: 8 bit, no parity, 1 stop bit
+    0x80, 0x25, 0x00, 0x00, // baudRate: 9600
+    0x07, 0x00,             // inProtoMask: UBX, NMEA, RTCM
+    0x03, 0x00,             // outProtoMask: UBX, NMEA
+    0x00, 0x00,             // flags
+    0x00, 0x00              // reserved5
+};
+
 // As the M10 has no flash, the best we can do to preserve the config is to set it in RAM and BBR.
 // BBR will survive a restart, and power off for a while, but modules with small backup
 // batteries or super caps will not retain the config for a long power off time.
@@ -61,34 +61,86 @@ bool EInkDisplay::forceDisplay(uint32_t msecLimit)
     else
         return false;
 
-    // FIXME - only draw bits have changed (use backbuf similar to the other displays)
-    const bool flipped = config.display.flip_screen;
-    for (uint32_t y = 0; y < displayHeight; y++) {
-        for (uint32_t x = 0; x < displayWidth; x++) {
-            // get src pixel in the page based ordering the OLED lib uses FIXME, super inefficient
-            auto b = buffer[x + (y / 8) * displayWidth];
-            auto isset = b & (1 << (y & 7));
-
-            // Handle flip here, rather than with setRotation(),
-            // Avoids issues when display width is not a multiple of 8
-            if (flipped)
-                adafruitDisplay->drawPixel((displayWidth - 1) - x, (displayHeight - 1) - y, isset ? GxEPD_BLACK : GxEPD_WHITE);
-            else
-                adafruitDisplay->drawPixel(x, y, isset ? GxEPD_BLACK : GxEPD_WHITE);
-        }
-    }
+    uint32_t startMicros = micros();
+    uint32_t numDrawn = drawChangedPixels();
+    uint32_t drawMicros = micros() - startMicros;
 
     // Trigger the refresh in GxEPD2
-    LOG_DEBUG("Updating E-Paper... ");
+    LOG_DEBUG("Updating E-Paper (drew %u pixels in %uus)... ", numDrawn, drawMicros);
+    uint32_t refreshStart = millis();
     adafruitDisplay->nextPage();
 
     // End the update process
     endUpdate();
 
-    LOG_DEBUG("done\n");
+    LOG_DEBUG("done in %ums\n", millis() - refreshStart);
     return true;
 }
 
+/**
+ * Copy buffer into GxEPD2's frame buffer, only drawing the pixels that changed since the last frame if we can
+ *
+ * @return the number of pixels drawn
+ */
+uint32_t EInkDisplay::drawChangedPixels()
+{
+    const bool flipped = config.display.flip_screen;
+    if (!drawnBuffer)
+        drawnBuffer = new uint8_t[displayBufferSize];
+    if (flipped != drawnFlipped)
+        driverInSync = false;
+
+    uint32_t numDrawn = 0;
+    const uint16_t numPages = (displayHeight + 7) / 8;
+    for (uint16_t page = 0; page < numPages; page++) {
+        const uint8_t *cur = buffer + page * displayWidth;
+        const uint8_t *old = drawnBuffer + page * displayWidth;
+
+        for (uint16_t x = 0; x < displayWidth; x++) {
+            // Skip 4 unchanged columns at a time, most of a frame is usually the same as the last one
+            if (driverInSync && (x & 3) == 0 && x + 4 <= displayWidth) {
+                uint32_t a, b;
+                memcpy(&a, cur + x, sizeof(a));
+                memcpy(&b, old + x, sizeof(b));
+                if (a == b) {
+                    x += 3;
+                    continue;
+                }
+            }
+
+            uint8_t changed = driverInSync ? (cur[x] ^ old[x]) : 0xFF;
+            for (uint8_t bit = 0; changed; bit++, changed >>= 1) {
+                uint16_t y = page * 8 + bit;
+                if (y >= displayHeight)
+                    break;
+                if (!(changed & 1))
+                    continue;
+
+                uint16_t color = (cur[x] & (1 << bit)) ? GxEPD_BLACK : GxEPD_WHITE;
+
+                // Handle flip here, rather than with setRotation(),
+                // Avoids issues when display width is not a multiple of 8
+                if (flipped)
+                    adafruitDisplay->drawPixel((displayWidth - 1) - x, (displayHeight - 1) - y, color);
+                else
+                    adafruitDisplay->drawPixel(x, y, color);
+                numDrawn++;
+            }
+        }
+    }
+
+    memcpy(drawnBuffer, buffer, displayBufferSize);
+    hasDrawn = true;
+    driverInSync = true;
+    drawnFlipped = flipped;
+    return numDrawn;
+}
+
+bool EInkDisplay::frameMatchesDrawn()
+{
+    return hasDrawn && drawnFlipped == config.display.flip_screen && memcmp(buffer, drawnBuffer, displayBufferSize) == 0;
+}
+
 // End the update process - virtual method, overriden in derived class
 void EInkDisplay::endUpdate()
 {
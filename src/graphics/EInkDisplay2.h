@@ -10,8 +10,10 @@
  *
  * Note: EInkDynamicDisplay derives from this class.
  *
+ * We keep a copy of the last frame we drew, so forceDisplay() only has to draw the pixels that changed into GxEPD2's frame
+ * buffer, and EInkDynamicDisplay can tell exactly when a frame is the same as the one on the panel.
+ *
  * Remaining TODO:
- * optimize display() to only draw changed pixels (see other OLED subclasses for examples)
  * implement displayOn/displayOff to turn off the TFT device (and backlight)
  * Use the fast NRF52 SPI API rather than the slow standard arduino version
  *
@@ -63,6 +65,13 @@ class EInkDisplay : public OLEDDisplay
     // Connect to the display
     virtual bool connect() override;
 
+    /// @return true if buffer holds exactly the frame we last drew (with the same flip), so it is already on the panel
+    bool frameMatchesDrawn();
+
+    /// Call if GxEPD2's frame buffer may have been changed behind our back (i.e. clearScreen() or a change of window),
+    /// the next frame will then be drawn in full
+    void invalidateDriverBuffer() { driverInSync = false; }
+
     // AdafruitGFX display object - instantiated in connect(), variant specific
     GxEPD2_BW<EINK_DISPLAY_MODEL, EINK_DISPLAY_MODEL::HEIGHT> *adafruitDisplay = NULL;
 
@@ -75,6 +84,13 @@ class EInkDisplay : public OLEDDisplay
   private:
     // FIXME quick hack to limit drawing to a very slow rate
     uint32_t lastDrawMsec = 0;
+
+    uint8_t *drawnBuffer = NULL; // the last frame we drew, allocated on first use
+    bool hasDrawn = false;       // drawnBuffer holds a frame
+    bool driverInSync = false;   // GxEPD2's frame buffer still holds drawnBuffer, so we only need to draw the changes
+    bool drawnFlipped = false;   // the flip_screen setting drawnBuffer was drawn with
+
+    uint32_t drawChangedPixels();
 };
 
 #endif
\ No newline at end of file
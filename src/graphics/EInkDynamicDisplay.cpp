@@ -72,12 +72,14 @@ void EInkDynamicDisplay::applyRefreshMode()
     if (currentConfig == FULL && refresh == FAST) {
         configForFastRefresh();
         currentConfig = FAST;
+        invalidateDriverBuffer(); // GxEPD2 lays out its frame buffer per window, draw the next frame in full to be safe
     }
 
     // Change from FAST back to FULL
     else if (currentConfig == FAST && refresh == FULL) {
         configForFullRefresh();
         currentConfig = FULL;
+        invalidateDriverBuffer();
     }
 }
 
@@ -155,7 +157,6 @@ bool EInkDynamicDisplay::determineMode()
     // -- New frame is due --
 
     resetRateLimiting(); // Once determineMode() ends, will have to wait again
-    hashImage();         // Generate here, so we can still copy it to previousImageHash, even if we skip the comparison check
     LOG_DEBUG("determineMode(): "); // Begin log entry
 
     // Once mode determined, any remaining checks will bypass
@@ -197,6 +198,7 @@ void EInkDynamicDisplay::checkInitialized()
 
         // Clear any existing image, so we can draw logo with fast-refresh, but also to set GxEPD2_EPD::_initial_write
         adafruitDisplay->clearScreen();
+        invalidateDriverBuffer();
 
         LOG_DEBUG("initialized, ");
         initialized = true;
@@ -299,7 +301,7 @@ void EInkDynamicDisplay::checkFrameMatchesPrevious()
         return;
 
     // If frame is *not* a duplicate, abort the check
-    if (imageHash != previousImageHash)
+    if (!frameMatchesDrawn())
         return;
 
 #if !defined(EINK_BACKGROUND_USES_FAST)
@@ -368,17 +370,6 @@ void EInkDynamicDisplay::resetRateLimiting()
     previousRunMs = millis();
 }
 
-// Generate a hash of this frame, to compare against previous update
-void EInkDynamicDisplay::hashImage()
-{
-    imageHash = 0;
-
-    // Sum all bytes of the image buffer together
-    for (uint16_t b = 0; b < (displayWidth / 8) * displayHeight; b++) {
-        imageHash += buffer[b];
-    }
-}
-
 // Store the results of determineMode() for future use, and reset for next call
 void EInkDynamicDisplay::storeAndReset()
 {
@@ -386,11 +377,6 @@ void EInkDynamicDisplay::storeAndReset()
     previousRefresh = refresh;
     previousReason = reason;
 
-    // Only store image hash if the display will update
-    if (refresh != SKIPPED) {
-        previousImageHash = imageHash;
-    }
-
     frameFlags = BACKGROUND;
     refresh = UNSPECIFIED;
 }
@@ -406,24 +392,24 @@ void EInkDynamicDisplay::countGhostPixels()
     // Start a new count
     ghostPixelCount = 0;
 
-    // Check new image, bit by bit, for any white pixels at locations marked "dirty"
-    for (uint16_t i = 0; i < displayBufferSize; i++) {
-        for (uint8_t bit = 0; bit < 7; bit++) {
-
-            const bool dirty = (dirtyPixels[i] >> bit) & 1;       // Has pixel location been drawn to since full-refresh?
-            const bool shouldBeBlank = !((buffer[i] >> bit) & 1); // Is pixel location white in the new image?
-
-            // If pixel is (or has been) black since last full-refresh, and now is white: ghosting
-            if (dirty && shouldBeBlank)
-                ghostPixelCount++;
-
-            // Update the dirty status for this pixel - will this location become a ghost if set white in future?
-            if (!dirty && !shouldBeBlank)
-                dirtyPixels[i] |= (1 << bit);
-        }
+    // Any pixel which is (or has been) black since last full-refresh, and now is white, is a ghost: dirty & ~new
+    // Every pixel black in the new image becomes dirty, so it will be a ghost if set white in future: dirty |= new
+    // Work through the buffers a 32 bit word at a time, then any bytes left over
+    uint32_t i = 0;
+    for (; i + sizeof(uint32_t) <= displayBufferSize; i += sizeof(uint32_t)) {
+        uint32_t dirty, image;
+        memcpy(&dirty, dirtyPixels + i, sizeof(dirty));
+        memcpy(&image, buffer + i, sizeof(image));
+        ghostPixelCount += __builtin_popcount(dirty & ~image);
+        dirty |= image;
+        memcpy(dirtyPixels + i, &dirty, sizeof(dirty));
+    }
+    for (; i < displayBufferSize; i++) {
+        ghostPixelCount += __builtin_popcount((uint8_t)(dirtyPixels[i] & ~buffer[i]));
+        dirtyPixels[i] |= buffer[i];
     }
 
-    LOG_DEBUG("ghostPixels=%hu, ", ghostPixelCount);
+    LOG_DEBUG("ghostPixels=%u, ", ghostPixelCount);
 }
 
 // Check if ghost pixel count exceeds the defined limit
@@ -1446,8 +1446,13 @@ static void drawNodeInfo(OLEDDisplay *display, OLEDDisplayUiState *state, int16_
             // display direction toward node
             hasNodeHeading = true;
             const meshtastic_PositionLite &p = node->position;
-            float d =
-                GeoCoord::latLongToMeter(DegD(p.latitude_i), DegD(p.longitude_i), DegD(op.latitude_i), DegD(op.longitude_i));
+
+            // Our own position rarely changes between frames, so keep its trig around for each node we flip through
+            static GeoOrigin origin(0, 0);
+            if (origin.getLatitude() != op.latitude_i || origin.getLongitude() != op.longitude_i)
+                origin = GeoOrigin(op.latitude_i, op.longitude_i);
+            float d, bearingToOther;
+            origin.distanceAndBearingTo(p.latitude_i, p.longitude_i, d, bearingToOther);
 
             if (config.display.units == meshtastic_Config_DisplayConfig_DisplayUnits_IMPERIAL) {
                 if (d < (2 * MILES_TO_FEET))
@@ -1461,8 +1466,6 @@ static void drawNodeInfo(OLEDDisplay *display, OLEDDisplayUiState *state, int16_
                     snprintf(distStr, sizeof(distStr), "%.1f km", d / 1000);
             }
 
-            float bearingToOther =
-                GeoCoord::bearing(DegD(op.latitude_i), DegD(op.longitude_i), DegD(p.latitude_i), DegD(p.longitude_i));
             // If the top of the compass is a static north then bearingToOther can be drawn on the compass directly
             // If the top of the compass is not a static north we need adjust bearingToOther based on heading
             if (!config.display.compass_north_top)
@@ -121,6 +121,7 @@ static LGFX *tft = nullptr;
 #include <TFT_eSPI.h>
 TFT_eSPI *tft = nullptr;
 FT6336U ft6336u;
+#define TFT_USES_TFT_ESPI
 
 static uint8_t _rak14014_touch_int = false; // TP interrupt generation flag.
 static void rak14014_tpIntHandle(void)
@@ -347,6 +348,7 @@ static LGFX *tft = nullptr;
 #include <TFT_eSPI.h> // Graphics and font library for ILI9341 driver chip
 
 static TFT_eSPI *tft = nullptr; // Invoke library, pins defined in User_Setup.h
+#define TFT_USES_TFT_ESPI
 #elif ARCH_PORTDUINO && HAS_SCREEN != 0
 #include <LovyanGFX.hpp> // Graphics and font library for ST7735 driver chip
 
@@ -536,6 +538,36 @@ TFTDisplay::TFTDisplay(uint8_t address, int sda, int scl, OLEDDISPLAY_GEOMETRY g
 #else
     setGeometry(GEOMETRY_RAWMODE, TFT_WIDTH, TFT_HEIGHT);
 #endif
+
+    // setGeometry() truncates the buffer to whole pages, round up so the bottom rows of a 135 or 170 pixel high screen fit
+    displayBufferSize = displayWidth * ((displayHeight + 7) / 8);
+}
+
+/// Find the first and last column of a page whose pixels differ from old (NULL meaning all black), or -1 if none do
+static void findChangedColumns(const uint8_t *cur, const uint8_t *old, uint16_t width, int16_t &first, int16_t &last)
+{
+    first = last = -1;
+
+    // Compare 4 columns at a time, most of a page is usually unchanged
+    uint16_t x = 0;
+    for (; x + 4 <= width; x += 4) {
+        uint32_t a, b = 0;
+        memcpy(&a, cur + x, sizeof(a));
+        if (old)
+            memcpy(&b, old + x, sizeof(b));
+        if (a != b) {
+            if (first < 0)
+                first = x;
+            last = x + 3;
+        }
+    }
+    for (; x < width; x++) {
+        if (cur[x] != (old ? old[x] : 0)) {
+            if (first < 0)
+                first = x;
+            last = x;
+        }
+    }
 }
 
 // Write the buffer to the display memory
@@ -546,28 +578,70 @@ void TFTDisplay::display(bool fromBlank)
     // tft->clear();
     concurrency::LockGuard g(spiLock);
 
-    uint16_t x, y;
-
-    for (y = 0; y < displayHeight; y++) {
-        for (x = 0; x < displayWidth; x++) {
-            auto isset = buffer[x + (y / 8) * displayWidth] & (1 << (y & 7));
-            if (!fromBlank) {
-                // get src pixel in the page based ordering the OLED lib uses FIXME, super inefficent
-                auto dblbuf_isset = buffer_back[x + (y / 8) * displayWidth] & (1 << (y & 7));
-                if (isset != dblbuf_isset) {
-                    tft->drawPixel(x, y, isset ? TFT_MESH : TFT_BLACK);
-                }
-            } else if (isset) {
-                tft->drawPixel(x, y, TFT_MESH);
+    uint32_t startMicros = micros();
+    if (!lineBuffer)
+        lineBuffer = new uint16_t[displayWidth];
+
+    // Each row's changed pixels (from the first to the last one that changed) are converted to RGB565 in lineBuffer and sent
+    // with one bulk write.  The address window is set up to run to the bottom of the screen, so a row whose span matches the
+    // one above it just continues the same window without any setup
+    int16_t windowX0 = -1, windowX1 = -1; // span of the address window we are filling, -1 if the row above wasn't sent
+    const uint16_t numPages = displayBufferSize / displayWidth; // the last one is only partly used on some screens
+    tft->startWrite();
+    for (uint16_t page = 0; page < numPages; page++) {
+        const uint8_t *cur = buffer + page * displayWidth;
+        const uint8_t *old = fromBlank ? NULL : buffer_back + page * displayWidth; // after fillScreen the panel is all black
+
+        int16_t first, last;
+        findChangedColumns(cur, old, displayWidth, first, last);
+        if (first < 0) {
+            windowX0 = -1;
+            continue;
+        }
+
+        const uint8_t numBits = (displayHeight - page * 8 < 8) ? displayHeight - page * 8 : 8;
+        for (uint8_t bit = 0; bit < numBits; bit++) {
+            uint8_t mask = 1 << bit;
+            int16_t x0 = first, x1 = last;
+            while (x0 <= x1 && !((cur[x0] ^ (old ? old[x0] : 0)) & mask))
+                x0++;
+            if (x0 > x1) {
+                windowX0 = -1;
+                continue;
             }
+            while (!((cur[x1] ^ (old ? old[x1] : 0)) & mask))
+                x1--;
+
+            uint16_t width = x1 - x0 + 1;
+            for (uint16_t i = 0; i < width; i++)
+                lineBuffer[i] = (cur[x0 + i] & mask) ? TFT_MESH : TFT_BLACK;
+
+            uint16_t y = page * 8 + bit;
+            if (x0 != windowX0 || x1 != windowX1) {
+                tft->setAddrWindow(x0, y, width, displayHeight - y);
+                windowX0 = x0;
+                windowX1 = x1;
+            }
+#ifdef TFT_USES_TFT_ESPI
+            tft->pushColors(lineBuffer, width, true); // true: our pixels are in native byte order
+#else
+            tft->writePixels(lineBuffer, width, true);
+#endif
         }
     }
+    tft->endWrite();
+
     // Copy the Buffer to the Back Buffer
-    for (y = 0; y < (displayHeight / 8); y++) {
-        for (x = 0; x < displayWidth; x++) {
-            uint16_t pos = x + y * displayWidth;
-            buffer_back[pos] = buffer[pos];
-        }
+    memcpy(buffer_back, buffer, displayBufferSize);
+
+    uint32_t frameMicros = micros() - startMicros;
+    frameMicrosTotal += frameMicros;
+    if (frameMicros > frameMicrosMax)
+        frameMicrosMax = frameMicros;
+    if (++numFrames % TFT_FRAME_STATS_INTERVAL == 0) {
+        LOG_DEBUG("TFT frame time over the last %u frames: avg=%uus max=%uus\n", TFT_FRAME_STATS_INTERVAL,
+                  frameMicrosTotal / TFT_FRAME_STATS_INTERVAL, frameMicrosMax);
+        frameMicrosTotal = frameMicrosMax = 0;
     }
 }
 
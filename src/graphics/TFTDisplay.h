@@ -2,11 +2,18 @@
 
 #include <OLEDDisplay.h>
 
+/// How many frames display() averages its frame time over before logging it
+#ifndef TFT_FRAME_STATS_INTERVAL
+#define TFT_FRAME_STATS_INTERVAL 100
+#endif
+
 /**
  * An adapter class that allows using the LovyanGFX library as if it was an OLEDDisplay implementation.
  *
+ * display() only sends the rows that changed since the last frame, each as one bulk write of the span of pixels that changed
+ * in it (see TFTDisplay.cpp)
+ *
  * Remaining TODO:
- * optimize display() to only draw changed pixels (see other OLED subclasses for examples)
  * Use the fast NRF52 SPI API rather than the slow standard arduino version
  *
  * turn radio back on - currently with both on spi bus is fucked? or are we leaving chip select asserted?
@@ -39,6 +46,9 @@ class TFTDisplay : public OLEDDisplay
      */
     void setDetected(uint8_t detected);
 
+    /// Number of frames display() has drawn
+    uint32_t getNumFrames() const { return numFrames; }
+
   protected:
     // the header size of the buffer used, e.g. for the SPI command header
     virtual int getBufferOffset(void) override { return 0; }
@@ -48,4 +58,10 @@ class TFTDisplay : public OLEDDisplay
 
     // Connect to the display
     virtual bool connect() override;
+
+  private:
+    uint16_t *lineBuffer = nullptr; // one row of RGB565 pixels on its way to the panel
+
+    uint32_t numFrames = 0;
+    uint32_t frameMicrosTotal = 0, frameMicrosMax = 0; // since we last logged them
 };
\ No newline at end of file
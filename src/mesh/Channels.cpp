@@ -75,6 +75,18 @@ meshtastic_Channel &Channels::fixupChannel(ChannelIndex chIndex)
 
     hashes[chIndex] = generateHash(chIndex);
 
+    // Expand the key once here, rather than rekeying the crypto engine for every packet.  A crypt might still be using the
+    // old key, it is only freed once that lets go of it
+    CryptoKey k = getKey(chIndex);
+    CryptoEngine::PreparedKey *newKey = (k.length < 0) ? NULL : crypto->prepareKey(k);
+    CryptoEngine::PreparedKey *oldKey;
+    {
+        concurrency::LockGuard g(&keyLock);
+        oldKey = preparedKeys[chIndex];
+        preparedKeys[chIndex] = newKey;
+    }
+    CryptoEngine::PreparedKey::release(oldKey);
+
     return ch;
 }
 
@@ -167,27 +179,13 @@ CryptoKey Channels::getKey(ChannelIndex chIndex)
     return k;
 }
 
-/** Given a channel index, change to use the crypto key specified by that index
- */
-int16_t Channels::setCrypto(ChannelIndex chIndex)
-{
-    CryptoKey k = getKey(chIndex);
-
-    if (k.length < 0)
-        return -1;
-    else {
-        // Tell our crypto engine about the psk
-        crypto->setKey(k);
-        return getHash(chIndex);
-    }
-}
-
 void Channels::initDefaults()
 {
     channelFile.channels_count = MAX_NUM_CHANNELS;
     for (int i = 0; i < channelFile.channels_count; i++)
         fixupChannel(i);
     initDefaultChannel(0);
+    generation++;
 }
 
 void Channels::onConfigChanged()
@@ -199,6 +197,7 @@ void Channels::onConfigChanged()
         if (ch.role == meshtastic_Channel_Role_PRIMARY)
             primaryIndex = i;
     }
+    generation++;
 #if !MESHTASTIC_EXCLUDE_MQTT
     if (channels.anyMqttEnabled() && mqtt && !mqtt->isEnabled()) {
         LOG_DEBUG("MQTT is enabled on at least one channel, so set MQTT thread to run immediately\n");
@@ -247,6 +246,7 @@ void Channels::setChannel(const meshtastic_Channel &c)
                 channelFile.channels[i].role = meshtastic_Channel_Role_SECONDARY;
 
     old = c; // slam in the new settings/role
+    generation++;
 }
 
 bool Channels::anyMqttEnabled()
@@ -302,7 +302,7 @@ bool Channels::hasDefaultChannel()
     return false;
 }
 
-/** Given a channel hash setup crypto for decoding that channel (or the primary channel if that channel is unsecured)
+/** Check whether a channel could have been used to encrypt a packet with the specified channel hash
  *
  * This method is called before decoding inbound packets
  *
@@ -316,12 +316,20 @@ bool Channels::decryptForHash(ChannelIndex chIndex, ChannelHash channelHash)
         return false;
     } else {
         LOG_DEBUG("Using channel %d (hash 0x%x)\n", chIndex, channelHash);
-        setCrypto(chIndex);
         return true;
     }
 }
 
-/** Given a channel index setup crypto for encoding that channel (or the primary channel if that channel is unsecured)
+const CryptoEngine::PreparedKey *Channels::acquirePreparedKey(ChannelIndex chIndex)
+{
+    concurrency::LockGuard g(&keyLock);
+    const CryptoEngine::PreparedKey *k = chIndex < getNumChannels() ? preparedKeys[chIndex] : NULL;
+    if (k)
+        k->retain();
+    return k;
+}
+
+/** Given a channel index, find the hash to put on packets we encode for that channel
  *
  * This method is called before encoding outbound packets
  *
@@ -329,5 +337,8 @@ bool Channels::decryptForHash(ChannelIndex chIndex, ChannelHash channelHash)
  */
 int16_t Channels::setActiveByIndex(ChannelIndex channelIndex)
 {
-    return setCrypto(channelIndex);
+    if (channelIndex >= getNumChannels() || !preparedKeys[channelIndex])
+        return -1;
+
+    return getHash(channelIndex);
 }
@@ -14,6 +14,22 @@ typedef uint8_t ChannelIndex;
  */
 typedef uint8_t ChannelHash;
 
+/** A reference to a channel's prepared key, held for as long as this is in scope */
+class PreparedKeyRef
+{
+  public:
+    explicit PreparedKeyRef(const CryptoEngine::PreparedKey *k) : key(k) {}
+    ~PreparedKeyRef() { CryptoEngine::PreparedKey::release(key); }
+
+    const CryptoEngine::PreparedKey *get() const { return key; }
+
+  private:
+    const CryptoEngine::PreparedKey *key;
+
+    PreparedKeyRef(const PreparedKeyRef &) = delete;
+    PreparedKeyRef &operator=(const PreparedKeyRef &) = delete;
+};
+
 /** The container/on device API for working with channels */
 class Channels
 {
@@ -28,6 +44,15 @@ class Channels
     /// the precomputed hashes for each of our channels, or -1 for invalid
     int16_t hashes[MAX_NUM_CHANNELS] = {};
 
+    /// the prepared (expanded) crypto keys for each of our channels, or NULL for invalid.  We hold a reference to each
+    CryptoEngine::PreparedKey *preparedKeys[MAX_NUM_CHANNELS] = {};
+
+    /// Guards swapping preparedKeys against acquirePreparedKey() taking a reference to one
+    concurrency::Lock keyLock;
+
+    /// bumped whenever the channel settings might have changed
+    uint32_t generation = 0;
+
   public:
     Channels() {}
 
@@ -61,28 +86,39 @@ class Channels
 
     ChannelIndex getNumChannels() { return channelFile.channels_count; }
 
+    /// Changes whenever our channel settings might have changed, so users can tell when to recompute anything they cached
+    uint32_t getGeneration() const { return generation; }
+
     /// Called by NodeDB on initial boot when the radio config settings are unset.  Set a default single channel config.
     void initDefaults();
 
     /// called when the user has just changed our radio config and we might need to change channel keys
     void onConfigChanged();
 
-    /** Given a channel hash setup crypto for decoding that channel (or the primary channel if that channel is unsecured)
+    /** Check whether a channel could have been used to encrypt a packet with the specified channel hash
      *
-     * This method is called before decoding inbound packets
+     * This method is called before decoding inbound packets, use getPreparedKey() to get the key for decrypting
      *
      * @return false if the channel hash or channel is invalid
      */
     bool decryptForHash(ChannelIndex chIndex, ChannelHash channelHash);
 
-    /** Given a channel index setup crypto for encoding that channel (or the primary channel if that channel is unsecured)
+    /** Given a channel index, find the hash to put on packets we encode for that channel
      *
-     * This method is called before encoding outbound packets
+     * This method is called before encoding outbound packets, use getPreparedKey() to get the key for encrypting
      *
      * @eturn the (0 to 255) hash for that channel - if no suitable channel could be found, return -1
      */
     int16_t setActiveByIndex(ChannelIndex channelIndex);
 
+    /** Return the key for encrypting/decrypting this channel (or the primary channel's key if this channel has no PSK)
+     *
+     * The caller gets its own reference, so the key stays valid (even if the channel is changed and we move on to a new
+     * key meanwhile) until the caller gives it back with CryptoEngine::PreparedKey::release().  Use PreparedKeyRef to have
+     * that done for you.  Returns NULL if the channel is invalid.
+     */
+    const CryptoEngine::PreparedKey *acquirePreparedKey(ChannelIndex chIndex);
+
     // Returns true if the channel has the default name and PSK
     bool isDefaultChannel(const meshtastic_Channel &ch);
 
@@ -93,12 +129,6 @@ class Channels
     bool anyMqttEnabled();
 
   private:
-    /** Given a channel index, change to use the crypto key specified by that index
-     *
-     * @eturn the (0 to 255) hash for that channel - if no suitable channel could be found, return -1
-     */
-    int16_t setCrypto(ChannelIndex chIndex);
-
     /** Return the channel index for the specified channel hash, or -1 for not found */
     int8_t getIndexByHash(ChannelHash channelHash);
 
@@ -24,12 +24,31 @@ void CryptoEngine::decrypt(uint32_t fromNode, uint64_t packetId, size_t numBytes
     LOG_WARN("noop decryption!\n");
 }
 
+void CryptoEngine::encrypt(CryptoContext &ctx, const PreparedKey &k, uint32_t fromNode, uint64_t packetId, size_t numBytes,
+                           const uint8_t *in, uint8_t *out)
+{
+    // This engine keeps its key and nonce as members, so only one packet at a time
+    concurrency::LockGuard g(cryptLock);
+
+    if (key.length != k.key.length || memcmp(key.bytes, k.key.bytes, sizeof(key.bytes)) != 0)
+        setKey(k.key);
+
+    if (out != in)
+        memcpy(out, in, numBytes);
+    encrypt(fromNode, packetId, numBytes, out);
+}
+
 /**
  * Init our 128 bit nonce for a new packet
  */
 void CryptoEngine::initNonce(uint32_t fromNode, uint64_t packetId)
 {
-    memset(nonce, 0, sizeof(nonce));
+    initNonce(nonce, fromNode, packetId);
+}
+
+void CryptoEngine::initNonce(uint8_t *nonce, uint32_t fromNode, uint64_t packetId)
+{
+    memset(nonce, 0, 16);
 
     // use memcpy to avoid breaking strict-aliasing
     memcpy(nonce, &packetId, sizeof(uint64_t));
@@ -2,6 +2,7 @@
 
 #include "concurrency/LockGuard.h"
 #include <Arduino.h>
+#include <atomic>
 
 extern concurrency::Lock *cryptLock;
 
@@ -19,6 +20,18 @@ struct CryptoKey {
 
 #define MAX_BLOCKSIZE 256
 
+/**
+ * The per call state for encrypting or decrypting one packet.  Owned by the caller (normally on its stack), so calls with
+ * different contexts never share any mutable state.
+ */
+struct CryptoContext {
+    /** The 128 bit counter block, starts as our per packet nonce */
+    uint8_t nonce[16];
+
+    /** Scratch for one block of AES-CTR keystream */
+    uint8_t streamBlock[16];
+};
+
 class CryptoEngine
 {
   protected:
@@ -28,8 +41,57 @@ class CryptoEngine
     CryptoKey key = {};
 
   public:
+    /**
+     * A key along with whatever the platform precomputed to use it (i.e. the AES key schedule).  Created once per key by
+     * prepareKey() and then only read, so any number of threads can use the same PreparedKey at once.
+     *
+     * It is reference counted, so whoever replaces a key doesn't free it under a crypt that is still using it.
+     */
+    class PreparedKey
+    {
+      public:
+        explicit PreparedKey(const CryptoKey &k) : key(k) {}
+        virtual ~PreparedKey() {}
+
+        const CryptoKey key;
+
+        /// Add a reference (the creator starts out holding one)
+        void retain() const { refs++; }
+
+        /// Drop a reference, deleting k once nobody holds one
+        static void release(const PreparedKey *k)
+        {
+            if (k && --k->refs == 0)
+                delete k;
+        }
+
+      private:
+        mutable std::atomic<uint16_t> refs{1};
+    };
+
     virtual ~CryptoEngine() {}
 
+    /**
+     * Do any per key work (i.e. expanding the AES key schedule) up front.  The caller owns the returned object.
+     */
+    virtual PreparedKey *prepareKey(const CryptoKey &k) { return new PreparedKey(k); }
+
+    /**
+     * Reentrant encrypt: numBytes of in are encrypted to out (which may be the same buffer as in).
+     *
+     * Engines that override this only touch ctx and the (read only) key, so it can run concurrently on several threads.  The
+     * default implementation falls back to setKey() and the in place encrypt() below, serialized by cryptLock.
+     */
+    virtual void encrypt(CryptoContext &ctx, const PreparedKey &k, uint32_t fromNode, uint64_t packetId, size_t numBytes,
+                         const uint8_t *in, uint8_t *out);
+
+    /// Reentrant decrypt, for CTR the implementation is the same as encrypt
+    void decrypt(CryptoContext &ctx, const PreparedKey &k, uint32_t fromNode, uint64_t packetId, size_t numBytes,
+                 const uint8_t *in, uint8_t *out)
+    {
+        encrypt(ctx, k, fromNode, packetId, numBytes, in, out);
+    }
+
     /**
      * Set the key used for encrypt, decrypt.
      *
@@ -59,6 +121,29 @@ class CryptoEngine
      * a 32 bit block counter (starts at zero)
      */
     void initNonce(uint32_t fromNode, uint64_t packetId);
+
+    /// Same as initNonce, but for a caller owned nonce
+    static void initNonce(uint8_t *nonce, uint32_t fromNode, uint64_t packetId);
+
+    /**
+     * AES-CTR using a block encrypt function, for engines whose cipher only offers that.  Uses a 32 bit big endian block
+     * counter at the end of ctx.nonce, like the rest of our CTR implementations.
+     */
+    template <typename BlockEncrypt>
+    static void ctrCrypt(CryptoContext &ctx, BlockEncrypt encryptBlock, size_t numBytes, const uint8_t *in, uint8_t *out)
+    {
+        for (size_t offset = 0; offset < numBytes; offset += sizeof(ctx.streamBlock)) {
+            encryptBlock(ctx.streamBlock, ctx.nonce);
+
+            size_t n = min(numBytes - offset, sizeof(ctx.streamBlock));
+            for (size_t i = 0; i < n; i++)
+                out[offset + i] = in[offset + i] ^ ctx.streamBlock[i];
+
+            for (int i = sizeof(ctx.nonce) - 1; i >= (int)sizeof(ctx.nonce) - 4; i--)
+                if (++ctx.nonce[i])
+                    break;
+        }
+    }
 };
 
 extern CryptoEngine *crypto;
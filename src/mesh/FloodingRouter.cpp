@@ -1,8 +1,12 @@
 #include "FloodingRouter.h"
+#include "airtime.h"
 #include "configuration.h"
 #include "mesh-pb-constants.h"
 
-FloodingRouter::FloodingRouter() {}
+FloodingRouter::FloodingRouter()
+{
+    routerStats.setPacketHistory(this);
+}
 
 /**
  * Send a packet on a suitable interface.  This routine will
@@ -21,17 +25,34 @@ bool FloodingRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
 {
     if (wasSeenRecently(p)) { // Note: this will also add a recent packet record
         printPacket("Ignoring incoming msg we've already seen", p);
-        if (config.device.role != meshtastic_Config_DeviceConfig_Role_ROUTER &&
-            config.device.role != meshtastic_Config_DeviceConfig_Role_REPEATER) {
-            // cancel rebroadcast of this message *if* there was already one, unless we're a router/repeater!
-            Router::cancelSending(p->from, p->id);
+        bool cancelled = false;
+        const PacketRecord *r = countDuplicate(p);
+        if (r && isCoverageLikely(*r)) {
+            // cancel rebroadcast of this message *if* there was already one
+            cancelled = Router::cancelSending(p->from, p->id);
+            if (cancelled && iface)
+                airTime->logAirtimeSaved(iface->getPacketTime(p)); // the copy we heard is the same size as ours
         }
+        if (iface)
+            iface->getTxScheduler()->onDuplicateHeard(p, cancelled);
         return true;
     }
 
     return Router::shouldFilterReceived(p);
 }
 
+bool FloodingRouter::isCoverageLikely(const PacketRecord &r) const
+{
+    if (config.device.role != meshtastic_Config_DeviceConfig_Role_ROUTER &&
+        config.device.role != meshtastic_Config_DeviceConfig_Role_REPEATER)
+        return r.numDuplicates >= 1;
+
+    if (FLOOD_ROUTER_SUPPRESS_DUPLICATES == 0)
+        return false;
+    return r.numDuplicates >= FLOOD_ROUTER_SUPPRESS_DUPLICATES ||
+           (r.numDuplicates >= FLOOD_ROUTER_SUPPRESS_NEAR_DUPLICATES && r.maxDuplicateSnr >= FLOOD_SUPPRESS_NEAR_SNR);
+}
+
 void FloodingRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtastic_Routing *c)
 {
     bool isAckorReply = (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) && (p->decoded.request_id != 0);
@@ -51,6 +72,7 @@ void FloodingRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtas
                 // Note: we are careful to resend using the original senders node id
                 // We are careful not to call our hooked version of send() - because we don't want to check this again
                 Router::send(tosend);
+                routerStats.mark(p, RouterStats::STAGE_REBROADCAST_QUEUED);
             } else {
                 LOG_DEBUG("Not rebroadcasting. Role = Role_ClientMute\n");
             }
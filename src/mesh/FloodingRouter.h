@@ -3,6 +3,22 @@
 #include "PacketHistory.h"
 #include "Router.h"
 
+/// ROUTER and REPEATER nodes drop their queued rebroadcast of a packet once they have heard this many other copies of it.
+/// 0 (the default) always rebroadcasts, as they did before this was added, variants that want suppression set it, e.g. to 3
+#ifndef FLOOD_ROUTER_SUPPRESS_DUPLICATES
+#define FLOOD_ROUTER_SUPPRESS_DUPLICATES 0
+#endif
+
+/// ... or this many, if one of them was heard from a near neighbour (whose coverage mostly overlaps our own)
+#ifndef FLOOD_ROUTER_SUPPRESS_NEAR_DUPLICATES
+#define FLOOD_ROUTER_SUPPRESS_NEAR_DUPLICATES 2
+#endif
+
+/// A copy heard at this SNR (in dB) or better comes from a near neighbour
+#ifndef FLOOD_SUPPRESS_NEAR_SNR
+#define FLOOD_SUPPRESS_NEAR_SNR 0
+#endif
+
 /**
  * This is a mixin that extends Router with the ability to do Naive Flooding (in the standard mesh protocol sense)
  *
@@ -23,6 +39,11 @@
   our own ID.  When resending we pick a random delay between 0 and 10 seconds to
   decrease the chance of collisions with transmitters we can not even hear.
 
+  While our rebroadcast waits for its delay we count the copies other nodes
+  send.  Once those make it likely our neighbours already have the packet
+  (see isCoverageLikely()) we drop our own copy.  ROUTER and REPEATER nodes
+  only do this if FLOOD_ROUTER_SUPPRESS_DUPLICATES is set.
+
   Any entries in recentBroadcasts that are older than X seconds (longer than the
   max time a flood can take) will be discarded.
  */
@@ -56,4 +77,14 @@ class FloodingRouter : public Router, protected PacketHistory
      * Look for broadcasts we need to rebroadcast
      */
     virtual void sniffReceived(const meshtastic_MeshPacket *p, const meshtastic_Routing *c) override;
+
+  private:
+    /**
+     * Given the copies of a packet we have heard from others, is our own rebroadcast of it unlikely to reach anyone new?
+     *
+     * Most nodes give up their rebroadcast at the first copy they hear.  ROUTER and REPEATER nodes are placed to extend
+     * coverage, so they always rebroadcast unless FLOOD_ROUTER_SUPPRESS_DUPLICATES is set, and then need several copies
+     * (fewer if one came from close by) before they stand down.
+     */
+    bool isCoverageLikely(const PacketRecord &r) const;
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 #include <assert.h>
+#include <atomic>
 
 #include "PointerQueue.h"
 
@@ -73,3 +74,103 @@ template <class T> class MemoryDynamic : public Allocator<T>
         return p;
     }
 };
+
+/**
+ * A fixed size pool of T, allocated once at construction so steady state packet traffic never touches the heap.
+ *
+ * Free buffers are kept on a lock-free stack (a Treiber stack), so alloc and release are safe to call from regular OR ISR
+ * code.  The head of the stack packs a 16 bit index and a 16 bit tag into one word, the tag is bumped on every pop to
+ * avoid the ABA problem.
+ *
+ * If the pool is ever exhausted we fall back to the heap (and count it) rather than asserting, release() knows to free()
+ * anything that didn't come from our slab.  That fallback is NOT safe from ISR code, so anything allocating from an ISR
+ * must be covered by the pool size.
+ */
+template <class T> class MemoryPool : public Allocator<T>
+{
+    static const uint16_t NO_BUFFER = UINT16_MAX;
+
+    T *buf;                         // our large raw block of memory
+    uint16_t *nextFree;             // for each free buffer, the index of the next free buffer
+    uint16_t maxElements;           // total number of buffers in buf
+    std::atomic<uint32_t> freeHead; // (tag << 16) | index of the first free buffer
+
+    std::atomic<uint16_t> numInUse{0};
+    std::atomic<uint16_t> highWaterMark{0};
+    std::atomic<uint32_t> numExhausted{0};
+
+  public:
+    explicit MemoryPool(uint16_t maxElements) : maxElements(maxElements)
+    {
+        assert(maxElements > 0 && maxElements < NO_BUFFER);
+        buf = (T *)malloc(maxElements * sizeof(T));
+        nextFree = (uint16_t *)malloc(maxElements * sizeof(uint16_t));
+        assert(buf && nextFree);
+
+        // prefill our free list
+        for (uint16_t i = 0; i < maxElements; i++)
+            nextFree[i] = (i + 1 < maxElements) ? i + 1 : NO_BUFFER;
+        freeHead = 0;
+    }
+
+    ~MemoryPool()
+    {
+        free(buf);
+        free(nextFree);
+    }
+
+    /// Return a buffer for use by others
+    virtual void release(T *p) override
+    {
+        assert(p);
+
+        if (p < buf || p >= buf + maxElements) {
+            free(p); // we handed this out from the heap because we were exhausted
+            return;
+        }
+
+        uint16_t index = p - buf;
+        assert(&buf[index] == p); // sanity check to make sure a programmer didn't pass in a pointer into the middle of an element
+
+        numInUse--;
+        uint32_t head = freeHead.load();
+        do {
+            nextFree[index] = head & 0xffff;
+        } while (!freeHead.compare_exchange_weak(head, (head & 0xffff0000) | index));
+    }
+
+    /// Number of buffers currently handed out from the pool
+    uint16_t getNumInUse() const { return numInUse; }
+
+    /// The most buffers that have ever been in use at the same time
+    uint16_t getHighWaterMark() const { return highWaterMark; }
+
+    /// How many times we had to fall back to the heap because the pool was empty
+    uint32_t getNumExhausted() const { return numExhausted; }
+
+    uint16_t getMaxElements() const { return maxElements; }
+
+  protected:
+    // Alloc some storage
+    virtual T *alloc(TickType_t maxWait) override
+    {
+        uint32_t head = freeHead.load();
+        uint16_t index;
+        do {
+            index = head & 0xffff;
+            if (index == NO_BUFFER) {
+                numExhausted++; // Note: malloc isn't ISR safe, see the class comment
+                T *p = (T *)malloc(sizeof(T));
+                assert(p);
+                return p;
+            }
+        } while (!freeHead.compare_exchange_weak(head, ((head + 0x10000) & 0xffff0000) | nextFree[index]));
+
+        uint16_t inUse = ++numInUse;
+        uint16_t oldMark = highWaterMark.load();
+        while (inUse > oldMark && !highWaterMark.compare_exchange_weak(oldMark, inUse))
+            ;
+
+        return &buf[index];
+    }
+};
@@ -4,10 +4,16 @@
 #include "NodeDB.h"
 #include "configuration.h"
 #include "modules/RoutingModule.h"
+#include <algorithm>
 #include <assert.h>
 
 std::vector<MeshModule *> *MeshModule::modules;
 
+std::vector<MeshModule::PortDispatch> *MeshModule::dispatch;
+MeshModule::PortDispatch *MeshModule::anyPort;
+bool MeshModule::dispatchValid;
+uint32_t MeshModule::boundChannelGeneration = UINT32_MAX;
+
 const meshtastic_MeshPacket *MeshModule::currentRequest;
 
 /**
@@ -23,6 +29,7 @@ MeshModule::MeshModule(const char *_name) : name(_name)
         modules = new std::vector<MeshModule *>();
 
     modules->push_back(this);
+    dispatchValid = false;
 }
 
 void MeshModule::setup() {}
@@ -72,6 +79,81 @@ meshtastic_MeshPacket *MeshModule::allocErrorResponse(meshtastic_Routing_Error e
     return r;
 }
 
+/**
+ * Sort our modules by the port they want.  Modules that didn't declare a port might want anything, so they are in every list
+ * (and anyPort, for ports no one declared).  Every list stays in registration order, which is the order we always called
+ * modules in.
+ */
+void MeshModule::buildDispatch()
+{
+    if (!dispatch) {
+        dispatch = new std::vector<PortDispatch>();
+        anyPort = new PortDispatch();
+    }
+    dispatch->clear();
+    *anyPort = PortDispatch();
+    anyPort->portNum = meshtastic_PortNum_UNKNOWN_APP;
+
+    for (auto m : *modules) {
+        auto portNum = m->getDispatchPortNum();
+        if (portNum == meshtastic_PortNum_UNKNOWN_APP)
+            continue;
+        auto it = std::lower_bound(dispatch->begin(), dispatch->end(), portNum,
+                                   [](const PortDispatch &d, meshtastic_PortNum n) { return d.portNum < n; });
+        if (it == dispatch->end() || it->portNum != portNum) {
+            PortDispatch d;
+            d.portNum = portNum;
+            dispatch->insert(it, d);
+        }
+    }
+
+    for (auto m : *modules) {
+        auto portNum = m->getDispatchPortNum();
+        for (auto &d : *dispatch) {
+            if (portNum == meshtastic_PortNum_UNKNOWN_APP || portNum == d.portNum) {
+                d.all.push_back(m);
+                if (m->isPromiscuous)
+                    d.promiscuous.push_back(m);
+            }
+        }
+        if (portNum == meshtastic_PortNum_UNKNOWN_APP) {
+            anyPort->all.push_back(m);
+            if (m->isPromiscuous)
+                anyPort->promiscuous.push_back(m);
+        }
+    }
+
+    LOG_DEBUG("Module dispatch: %u modules, %u ports, %u want any port\n", (unsigned)modules->size(),
+              (unsigned)dispatch->size(), (unsigned)anyPort->all.size());
+    dispatchValid = true;
+}
+
+/// Figure out which channels each module bound to a channel name will accept packets from
+void MeshModule::resolveBoundChannels()
+{
+    for (auto m : *modules) {
+        m->boundChannelMask = 0;
+        if (!m->boundChannel)
+            continue;
+        for (ChannelIndex i = 0; i < channels.getNumChannels() && i < 8 * sizeof(m->boundChannelMask); i++)
+            if (strcasecmp(channels.getByIndex(i).settings.name, m->boundChannel) == 0)
+                m->boundChannelMask |= 1 << i;
+    }
+    boundChannelGeneration = channels.getGeneration();
+}
+
+const std::vector<MeshModule *> &MeshModule::getCandidates(meshtastic_PortNum portNum, bool toUs)
+{
+    const PortDispatch *d = anyPort;
+    auto it = std::lower_bound(dispatch->begin(), dispatch->end(), portNum,
+                               [](const PortDispatch &e, meshtastic_PortNum n) { return e.portNum < n; });
+    if (it != dispatch->end() && it->portNum == portNum)
+        d = &*it;
+
+    // Modules that aren't promiscuous never see packets that aren't for us
+    return toUs ? d->all : d->promiscuous;
+}
+
 void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
 {
     // LOG_DEBUG("In call modules\n");
@@ -88,7 +170,15 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
     auto ourNodeNum = nodeDB->getNodeNum();
     bool toUs = mp.to == NODENUM_BROADCAST || mp.to == ourNodeNum;
 
-    for (auto i = modules->begin(); i != modules->end(); ++i) {
+    if (!dispatchValid)
+        buildDispatch();
+    if (boundChannelGeneration != channels.getGeneration())
+        resolveBoundChannels();
+
+    // Encrypted packets have no portnum to go by, so every module gets a look at them
+    const std::vector<MeshModule *> &candidates = isDecoded ? getCandidates(mp.decoded.portnum, toUs) : *modules;
+
+    for (auto i = candidates.begin(); i != candidates.end(); ++i) {
         auto &pi = **i;
 
         pi.currentRequest = &mp;
@@ -108,16 +198,15 @@ void MeshModule::callModules(meshtastic_MeshPacket &mp, RxSource src)
 
             moduleFound = true;
 
-            /// received channel (or NULL if not decoded)
-            meshtastic_Channel *ch = isDecoded ? &channels.getByIndex(mp.channel) : NULL;
-
             /// Is the channel this packet arrived on acceptable? (security check)
             /// Note: we can't know channel names for encrypted packets, so those are NEVER sent to boundChannel modules
 
             /// Also: if a packet comes in on the local PC interface, we don't check for bound channels, because it is TRUSTED and
             /// it needs to to be able to fetch the initial admin packets without yet knowing any channels.
 
-            bool rxChannelOk = !pi.boundChannel || (mp.from == 0) || (ch && strcasecmp(ch->settings.name, pi.boundChannel) == 0);
+            bool rxChannelOk = !pi.boundChannel || (mp.from == 0) ||
+                               (isDecoded && mp.channel < 8 * sizeof(pi.boundChannelMask) &&
+                                ((pi.boundChannelMask >> mp.channel) & 1));
 
             if (!rxChannelOk) {
                 // no one should have already replied!
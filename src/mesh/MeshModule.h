@@ -60,6 +60,29 @@ class MeshModule
 {
     static std::vector<MeshModule *> *modules;
 
+    /// The modules that might want packets on one particular port, in registration order
+    struct PortDispatch {
+        meshtastic_PortNum portNum;
+        std::vector<MeshModule *> all, promiscuous;
+    };
+
+    /// Built by buildDispatch(), sorted by portNum.  Ports nobody declared use anyPort.
+    static std::vector<PortDispatch> *dispatch;
+    static PortDispatch *anyPort;
+    static bool dispatchValid;
+
+    /// Channels::getGeneration() when we last resolved boundChannel to boundChannelMask
+    static uint32_t boundChannelGeneration;
+
+    /// Bit n is set if channel n is named boundChannel
+    uint8_t boundChannelMask = 0;
+
+    static void buildDispatch();
+    static void resolveBoundChannels();
+
+    /// @return the modules (in registration order) that might want a decoded packet on portNum
+    static const std::vector<MeshModule *> &getCandidates(meshtastic_PortNum portNum, bool toUs);
+
   public:
     /** Constructor
      * name is for debugging output
@@ -134,6 +157,14 @@ class MeshModule
      */
     virtual bool wantPacket(const meshtastic_MeshPacket *p) = 0;
 
+    /**
+     * If wantPacket() can only ever be true for decoded packets on one port, return that port so callModules doesn't need to ask
+     * about any other packets.  Return meshtastic_PortNum_UNKNOWN_APP (the default) to be asked about every packet.
+     *
+     * Only called once all modules have been constructed.
+     */
+    virtual meshtastic_PortNum getDispatchPortNum() { return meshtastic_PortNum_UNKNOWN_APP; }
+
     /** Called to handle a particular incoming message
 
     @return ProcessMessage::STOP if you've guaranteed you've handled this message and no other handlers should be considered for
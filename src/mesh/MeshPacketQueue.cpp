@@ -24,11 +24,30 @@ bool CompareMeshPacketFunc(const meshtastic_MeshPacket *p1, const meshtastic_Mes
                         : (p1->id >= p2->id); // prefer smaller packet ids
 }
 
-MeshPacketQueue::MeshPacketQueue(size_t _maxLen) : maxLen(_maxLen) {}
+const uint16_t MeshPacketQueue::NO_ENTRY;
+
+MeshPacketQueue::MeshPacketQueue(size_t _maxLen) : maxLen(_maxLen)
+{
+    assert(maxLen < NO_ENTRY);
+
+    // Allocate everything up front, so enqueuing never touches the heap
+    entries.resize(maxLen);
+    freeEntries.reserve(maxLen);
+    for (size_t i = maxLen; i-- > 0;)
+        freeEntries.push_back(i);
+    heaps[HIGHEST].reserve(maxLen);
+    heaps[LOWEST].reserve(maxLen);
+
+    size_t indexSize = 2;
+    while (indexSize < maxLen * 2)
+        indexSize <<= 1;
+    idIndex.assign(indexSize, NO_ENTRY);
+    idMask = indexSize - 1;
+}
 
 bool MeshPacketQueue::empty()
 {
-    return queue.empty();
+    return heaps[HIGHEST].empty();
 }
 
 /**
@@ -53,12 +72,16 @@ bool MeshPacketQueue::enqueue(meshtastic_MeshPacket *p)
     fixPriority(p);
 
     // no space - try to replace a lower priority packet in the queue
-    if (queue.size() >= maxLen) {
+    if (freeEntries.empty()) {
         return replaceLowerPriorityPacket(p);
     }
 
-    queue.push_back(p);
-    std::push_heap(queue.begin(), queue.end(), &CompareMeshPacketFunc);
+    uint16_t e = freeEntries.back();
+    freeEntries.pop_back();
+    entries[e].p = p;
+    heapPush(HIGHEST, e);
+    heapPush(LOWEST, e);
+    idIndexAdd(e);
     return true;
 }
 
@@ -68,11 +91,7 @@ meshtastic_MeshPacket *MeshPacketQueue::dequeue()
         return NULL;
     }
 
-    auto *p = queue.front();
-    std::pop_heap(queue.begin(), queue.end(), &CompareMeshPacketFunc);
-    queue.pop_back();
-
-    return p;
+    return removeEntry(heaps[HIGHEST].front());
 }
 
 meshtastic_MeshPacket *MeshPacketQueue::getFront()
@@ -81,50 +100,150 @@ meshtastic_MeshPacket *MeshPacketQueue::getFront()
         return NULL;
     }
 
-    auto *p = queue.front();
-    return p;
+    return entries[heaps[HIGHEST].front()].p;
 }
 
 /** Attempt to find and remove a packet from this queue.  Returns a pointer to the removed packet, or NULL if not found */
 meshtastic_MeshPacket *MeshPacketQueue::remove(NodeNum from, PacketId id)
 {
-    for (auto it = queue.begin(); it != queue.end(); it++) {
-        auto p = (*it);
-        if (getFrom(p) == from && p->id == id) {
-            queue.erase(it);
-            std::make_heap(queue.begin(), queue.end(), &CompareMeshPacketFunc);
-            return p;
-        }
+    for (uint32_t i = idHash(from, id);; i = (i + 1) & idMask) {
+        uint16_t e = idIndex[i];
+        if (e == NO_ENTRY)
+            return NULL;
+
+        auto p = entries[e].p;
+        if (getFrom(p) == from && p->id == id)
+            return removeEntry(e);
     }
-
-    return NULL;
 }
 
-/** Attempt to find and remove a packet from this queue.  Returns the packet which was removed from the queue */
+/** Drop the lowest priority packet in the queue in favor of 'p', if 'p' has a higher priority.  Return true if replaced. */
 bool MeshPacketQueue::replaceLowerPriorityPacket(meshtastic_MeshPacket *p)
 {
-    std::sort_heap(queue.begin(), queue.end(), &CompareMeshPacketFunc); // sort ascending based on priority (0 -> 127)
-
-    // find first packet which does not compare less (in priority) than parameter packet
-    auto low = std::lower_bound(queue.begin(), queue.end(), p, &CompareMeshPacketFunc);
+    if (empty()) { // a zero length queue
+        return false;
+    }
 
-    if (low == queue.begin()) { // if already at start, there are no packets with lower priority
+    uint16_t low = heaps[LOWEST].front();
+    if (getPriority(p) <= getPriority(entries[low].p)) { // nothing in the queue has a lower priority
         return false;
     }
 
-    if (low == queue.end()) {
-        // all priorities in the vector are smaller than the incoming packet. Replace the lowest priority (first) element
-        low = queue.begin();
-    } else {
-        // 'low' iterator points to first packet which does not compare less than parameter
-        --low; // iterate to lower priority packet
+    packetPool.release(removeEntry(low)); // deallocate and drop the packet we're replacing
+    return enqueue(p);
+}
+
+meshtastic_MeshPacket *MeshPacketQueue::removeEntry(uint16_t e)
+{
+    heapRemove(HIGHEST, entries[e].heapPos[HIGHEST]);
+    heapRemove(LOWEST, entries[e].heapPos[LOWEST]);
+    idIndexRemove(e);
+    freeEntries.push_back(e);
+
+    auto p = entries[e].p;
+    entries[e].p = NULL;
+    return p;
+}
+
+bool MeshPacketQueue::above(HeapKind which, uint16_t a, uint16_t b) const
+{
+    // CompareMeshPacketFunc(x, y) is true if x should be sent after y
+    return (which == HIGHEST) ? CompareMeshPacketFunc(entries[b].p, entries[a].p)
+                              : CompareMeshPacketFunc(entries[a].p, entries[b].p);
+}
+
+void MeshPacketQueue::heapPlace(HeapKind which, size_t pos, uint16_t e)
+{
+    heaps[which][pos] = e;
+    entries[e].heapPos[which] = pos;
+}
+
+void MeshPacketQueue::heapPush(HeapKind which, uint16_t e)
+{
+    heaps[which].push_back(e);
+    entries[e].heapPos[which] = heaps[which].size() - 1;
+    siftUp(which, heaps[which].size() - 1);
+}
+
+void MeshPacketQueue::heapRemove(HeapKind which, size_t pos)
+{
+    auto &heap = heaps[which];
+    uint16_t last = heap.back();
+    heap.pop_back();
+    if (pos == heap.size()) // we removed the last element, nothing to fix up
+        return;
+
+    // Move the last element into the hole, it might need to go either way from there
+    heapPlace(which, pos, last);
+    siftUp(which, pos);
+    siftDown(which, entries[last].heapPos[which]);
+}
+
+void MeshPacketQueue::siftUp(HeapKind which, size_t pos)
+{
+    auto &heap = heaps[which];
+    uint16_t e = heap[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!above(which, e, heap[parent]))
+            break;
+        heapPlace(which, pos, heap[parent]);
+        pos = parent;
     }
+    heapPlace(which, pos, e);
+}
 
-    if (getPriority(p) > getPriority(*low)) {
-        packetPool.release(*low); // deallocate and drop the packet we're replacing
-        *low = p;                 // replace low-pri packet at this position with incoming packet with higher priority
+void MeshPacketQueue::siftDown(HeapKind which, size_t pos)
+{
+    auto &heap = heaps[which];
+    uint16_t e = heap[pos];
+    size_t n = heap.size();
+    while (true) {
+        size_t child = 2 * pos + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && above(which, heap[child + 1], heap[child]))
+            child++;
+        if (!above(which, heap[child], e))
+            break;
+        heapPlace(which, pos, heap[child]);
+        pos = child;
     }
+    heapPlace(which, pos, e);
+}
 
-    std::make_heap(queue.begin(), queue.end(), &CompareMeshPacketFunc);
-    return true;
+uint32_t MeshPacketQueue::idHash(NodeNum from, PacketId id) const
+{
+    uint32_t h = from ^ (id * 0x9E3779B1UL);
+    h ^= h >> 15;
+    return h & idMask;
+}
+
+void MeshPacketQueue::idIndexAdd(uint16_t e)
+{
+    auto p = entries[e].p;
+    uint32_t i = idHash(getFrom(p), p->id);
+    while (idIndex[i] != NO_ENTRY)
+        i = (i + 1) & idMask;
+    idIndex[i] = e;
+}
+
+void MeshPacketQueue::idIndexRemove(uint16_t e)
+{
+    auto p = entries[e].p;
+    uint32_t i = idHash(getFrom(p), p->id);
+    while (idIndex[i] != e)
+        i = (i + 1) & idMask;
+
+    // Backward shift deletion, pull later members of this probe chain into the hole so we never need tombstones
+    for (uint32_t j = (i + 1) & idMask; idIndex[j] != NO_ENTRY; j = (j + 1) & idMask) {
+        auto q = entries[idIndex[j]].p;
+        uint32_t home = idHash(getFrom(q), q->id);
+        bool homeBetween = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (!homeBetween) {
+            idIndex[i] = idIndex[j];
+            i = j;
+        }
+    }
+    idIndex[i] = NO_ENTRY;
 }
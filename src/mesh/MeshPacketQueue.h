@@ -2,15 +2,46 @@
 
 #include "MeshTypes.h"
 
-#include <queue>
+#include <vector>
 
 /**
  * A priority queue of packets
+ *
+ * Packets live in a fixed table of entries.  Two indexed binary heaps over that table keep the next packet to send and the
+ * first packet to drop at their fronts, and a small (from, id) hash finds packets to cancel.  Every entry remembers its
+ * position in both heaps, so enqueue, dequeue, remove and drop-lowest are all O(log n) without ever re-heapifying.
  */
 class MeshPacketQueue
 {
+    struct Entry {
+        meshtastic_MeshPacket *p;
+        uint16_t heapPos[2]; // our current position in each of the heaps
+    };
+
+    /// Which heap: HIGHEST has the packet we should send next at its front, LOWEST has the packet we'd drop first
+    enum HeapKind { HIGHEST = 0, LOWEST = 1 };
+
+    static const uint16_t NO_ENTRY = UINT16_MAX;
+
     size_t maxLen;
-    std::vector<meshtastic_MeshPacket *> queue;
+    std::vector<Entry> entries;
+    std::vector<uint16_t> freeEntries;
+    std::vector<uint16_t> heaps[2];
+    std::vector<uint16_t> idIndex; // (from, id) hash of entry numbers
+    uint32_t idMask;
+
+    /// @return true if entry a belongs above entry b in the specified heap
+    bool above(HeapKind which, uint16_t a, uint16_t b) const;
+
+    void heapPlace(HeapKind which, size_t pos, uint16_t e);
+    void heapPush(HeapKind which, uint16_t e), heapRemove(HeapKind which, size_t pos);
+    void siftUp(HeapKind which, size_t pos), siftDown(HeapKind which, size_t pos);
+
+    uint32_t idHash(NodeNum from, PacketId id) const;
+    void idIndexAdd(uint16_t e), idIndexRemove(uint16_t e);
+
+    /// Take an entry out of both heaps and the id index, returning its packet
+    meshtastic_MeshPacket *removeEntry(uint16_t e);
 
     /** Replace a lower priority package in the queue with 'mp' (provided there are lower pri packages). Return true if replaced.
      */
@@ -26,7 +57,7 @@ class MeshPacketQueue
     bool empty();
 
     /** return amount of free packets in Queue */
-    size_t getFree() { return maxLen - queue.size(); }
+    size_t getFree() { return maxLen - heaps[HIGHEST].size(); }
 
     /** return total size of the Queue */
     size_t getMaxLen() { return maxLen; }
@@ -8,6 +8,7 @@
 #include "BluetoothCommon.h" // needed for updateBatteryLevel, FIXME, eventually when we pull mesh out into a lib we shouldn't be whacking bluetooth from here
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "PacketTrace.h"
 #include "PowerFSM.h"
 #include "RTC.h"
 #include "TypeConversions.h"
@@ -83,7 +84,10 @@ void MeshService::init()
 
 int MeshService::handleFromRadio(const meshtastic_MeshPacket *mp)
 {
-    powerFSM.trigger(EVENT_PACKET_FOR_PHONE); // Possibly keep the node from sleeping
+    if (inRxBatch)
+        rxBatchWantsWake = true; // endRxBatch() will trigger it once for the whole batch
+    else
+        powerFSM.trigger(EVENT_PACKET_FOR_PHONE); // Possibly keep the node from sleeping
 
     nodeDB->updateFrom(*mp); // update our DB state based off sniffing every RX packet from the radio
     if (mp->which_payload_variant == meshtastic_MeshPacket_decoded_tag &&
@@ -115,6 +119,13 @@ void MeshService::loop()
         if (qs.free != lastQueueStatus.free)
             (void)sendQueueStatusToPhone(qs, 0, 0);
     }
+    notifyFromNumChanged();
+
+    packetTrace.flush(); // log the packets we handled since our last loop, now we aren't in the middle of handling them
+}
+
+void MeshService::notifyFromNumChanged()
+{
     if (oldFromNum != fromNum) { // We don't want to generate extra notifies for multiple new packets
         int result = fromNumChanged.notifyObservers(fromNum);
         if (result == 0) // If any observer returns non-zero, we will try again
@@ -122,6 +133,22 @@ void MeshService::loop()
     }
 }
 
+void MeshService::beginRxBatch()
+{
+    inRxBatch = true;
+    rxBatchWantsWake = false;
+    nodeDB->beginBatch();
+}
+
+void MeshService::endRxBatch()
+{
+    inRxBatch = false;
+    nodeDB->endBatch();
+    if (rxBatchWantsWake)
+        powerFSM.trigger(EVENT_PACKET_FOR_PHONE); // Possibly keep the node from sleeping
+    notifyFromNumChanged(); // don't make the phone wait for our next loop() to hear about the batch
+}
+
 /// The radioConfig object just changed, call this to force the hw to change to the new settings
 bool MeshService::reloadConfig(int saveWhat)
 {
@@ -230,19 +257,15 @@ ErrorCode MeshService::sendQueueStatusToPhone(const meshtastic_QueueStatus &qs,
     copied->res = res;
     copied->mesh_packet_id = mesh_packet_id;
 
-    if (toPhoneQueueStatusQueue.numFree() == 0) {
-        LOG_DEBUG("NOTE: tophone queue status queue is full, discarding oldest\n");
-        meshtastic_QueueStatus *d = toPhoneQueueStatusQueue.dequeuePtr(0);
-        if (d)
-            releaseQueueStatusToPool(d);
-    }
-
     lastQueueStatus = *copied;
 
-    res = toPhoneQueueStatusQueue.enqueue(copied, 0);
+    toPhoneQueueStatusQueue.enqueueDropOldest(copied, [this](meshtastic_QueueStatus *d) {
+        LOG_DEBUG("NOTE: tophone queue status queue is full, discarding oldest\n");
+        releaseQueueStatusToPool(d);
+    });
     fromNum++;
 
-    return res ? ERRNO_OK : ERRNO_UNKNOWN;
+    return ERRNO_OK;
 }
 
 void MeshService::sendToMesh(meshtastic_MeshPacket *p, RxSource src, bool ccToPhone)
@@ -304,36 +327,26 @@ void MeshService::sendToPhone(meshtastic_MeshPacket *p)
 #endif
 #endif
 
-    if (toPhoneQueue.numFree() == 0) {
-        if (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP ||
-            p->decoded.portnum == meshtastic_PortNum_RANGE_TEST_APP) {
+    if (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP || p->decoded.portnum == meshtastic_PortNum_RANGE_TEST_APP) {
+        toPhoneQueue.enqueueDropOldest(p, [this](meshtastic_MeshPacket *d) {
             LOG_WARN("ToPhone queue is full, discarding oldest\n");
-            meshtastic_MeshPacket *d = toPhoneQueue.dequeuePtr(0);
-            if (d)
-                releaseToPool(d);
-        } else {
-            LOG_WARN("ToPhone queue is full, dropping packet.\n");
-            releaseToPool(p);
-            fromNum++; // Make sure to notify observers in case they are reconnected so they can get the packets
-            return;
-        }
+            releaseToPool(d);
+        });
+    } else if (!toPhoneQueue.enqueue(p, 0)) {
+        LOG_WARN("ToPhone queue is full, dropping packet.\n");
+        releaseToPool(p);
+        // Still notify observers in case they are reconnected so they can get the packets
     }
-
-    assert(toPhoneQueue.enqueue(p, 0));
     fromNum++;
 }
 
 void MeshService::sendMqttMessageToClientProxy(meshtastic_MqttClientProxyMessage *m)
 {
     LOG_DEBUG("Sending mqtt message on topic '%s' to client for proxying to server\n", m->topic);
-    if (toPhoneMqttProxyQueue.numFree() == 0) {
+    toPhoneMqttProxyQueue.enqueueDropOldest(m, [this](meshtastic_MqttClientProxyMessage *d) {
         LOG_WARN("MqttClientProxyMessagePool queue is full, discarding oldest\n");
-        meshtastic_MqttClientProxyMessage *d = toPhoneMqttProxyQueue.dequeuePtr(0);
-        if (d)
-            releaseMqttClientProxyMessageToPool(d);
-    }
-
-    assert(toPhoneMqttProxyQueue.enqueue(m, 0));
+        releaseMqttClientProxyMessageToPool(d);
+    });
     fromNum++;
 }
 
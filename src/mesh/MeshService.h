@@ -53,6 +53,12 @@ class MeshService
     /// Updated in loop() to detect when fromNum changes
     uint32_t oldFromNum = 0;
 
+    bool inRxBatch = false;        // between beginRxBatch() and endRxBatch()
+    bool rxBatchWantsWake = false; // a packet in the current batch should keep us from sleeping
+
+    /// Tell our observers (the phone APIs) if fromNum changed since we last told them
+    void notifyFromNumChanged();
+
   public:
     static bool isTextPayload(const meshtastic_MeshPacket *p)
     {
@@ -75,6 +81,15 @@ class MeshService
     /// Do idle processing (mostly processing messages which have been queued from the radio)
     void loop();
 
+    /**
+     * The router is about to handle a burst of received packets.  Until endRxBatch() we (and NodeDB) just note what
+     * changed, rather than waking the power FSM, the screen and the phone for every packet
+     */
+    void beginRxBatch();
+
+    /// The burst is done, send each of the notifications held back since beginRxBatch() once
+    void endRxBatch();
+
     /// Return the next packet destined to the phone.  FIXME, somehow use fromNum to allow the phone to retry the
     /// last few packets if needs to.
     meshtastic_MeshPacket *getForPhone() { return toPhoneQueue.dequeuePtr(0); }
@@ -0,0 +1,116 @@
+#include "NodeAgeIndex.h"
+#include "configuration.h"
+
+const uint16_t NodeAgeIndex::NOT_IN_HEAP;
+
+void NodeAgeIndex::rebuild(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t count, size_t maxNodes)
+{
+    heap.clear();
+    heap.reserve(maxNodes);
+    heapPos.assign(maxNodes, NOT_IN_HEAP);
+
+    for (size_t i = 1; i < count && i < NOT_IN_HEAP; i++)
+        if (!nodes[i].is_favorite) {
+            heapPos[i] = heap.size();
+            heap.push_back({nodes[i].last_heard, (uint16_t)i});
+        }
+
+    // Bottom up heapify, O(n)
+    for (size_t i = heap.size() / 2; i-- > 0;)
+        siftDown(i);
+}
+
+void NodeAgeIndex::update(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t slot)
+{
+    if (slot == 0 || slot >= heapPos.size())
+        return;
+
+    if (nodes[slot].is_favorite) {
+        remove(slot);
+        return;
+    }
+
+    uint16_t pos = heapPos[slot];
+    if (pos == NOT_IN_HEAP) {
+        heap.push_back({nodes[slot].last_heard, (uint16_t)slot});
+        heapPos[slot] = heap.size() - 1;
+        siftUp(heap.size() - 1);
+    } else {
+        uint32_t old = heap[pos].lastHeard;
+        heap[pos].lastHeard = nodes[slot].last_heard;
+        if (heap[pos].lastHeard < old)
+            siftUp(pos);
+        else
+            siftDown(pos);
+    }
+}
+
+void NodeAgeIndex::remove(size_t slot)
+{
+    if (slot >= heapPos.size() || heapPos[slot] == NOT_IN_HEAP)
+        return;
+
+    size_t pos = heapPos[slot];
+    heapPos[slot] = NOT_IN_HEAP;
+
+    Entry last = heap.back();
+    heap.pop_back();
+    if (pos < heap.size()) {
+        // Fill the hole with the last entry, which might belong either above or below it
+        place(pos, last);
+        siftUp(pos);
+        siftDown(heapPos[last.slot]);
+    }
+}
+
+int NodeAgeIndex::findOldest(const std::vector<meshtastic_NodeInfoLite> &nodes)
+{
+    while (!heap.empty()) {
+        const Entry &top = heap[0];
+        const meshtastic_NodeInfoLite &n = nodes[top.slot];
+
+        // Someone changed this node without telling us, fix its place and look again
+        if (n.is_favorite || n.last_heard != top.lastHeard)
+            update(nodes, top.slot);
+        else
+            return top.slot;
+    }
+    return -1;
+}
+
+void NodeAgeIndex::place(size_t pos, const Entry &e)
+{
+    heap[pos] = e;
+    heapPos[e.slot] = pos;
+}
+
+void NodeAgeIndex::siftUp(size_t pos)
+{
+    Entry e = heap[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (heap[parent].lastHeard <= e.lastHeard)
+            break;
+        place(pos, heap[parent]);
+        pos = parent;
+    }
+    place(pos, e);
+}
+
+void NodeAgeIndex::siftDown(size_t pos)
+{
+    Entry e = heap[pos];
+    size_t n = heap.size();
+    for (;;) {
+        size_t child = 2 * pos + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && heap[child + 1].lastHeard < heap[child].lastHeard)
+            child++;
+        if (e.lastHeard <= heap[child].lastHeard)
+            break;
+        place(pos, heap[child]);
+        pos = child;
+    }
+    place(pos, e);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include <vector>
+
+/**
+ * An indexed min-heap of NodeDB slots ordered by last_heard, so when the DB is full we can find the node to evict
+ * (the least recently heard one that isn't a favorite) in O(log n) instead of scanning every node.
+ *
+ * Slot 0 (our own node) and favorites are never in the heap.  Every slot remembers its position in the heap, so a node
+ * whose last_heard or favorite flag changed is re-sifted in place with update().  Each entry also keeps the last_heard it
+ * was sorted by, so a node heard again or made a favorite behind our back (without an update()) is noticed and fixed up
+ * when it reaches the top.
+ */
+class NodeAgeIndex
+{
+  public:
+    /// Index slots 1 to count - 1 of nodes, with room for maxNodes slots
+    void rebuild(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t count, size_t maxNodes);
+
+    /// The node in slot was added or its last_heard or is_favorite changed
+    void update(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t slot);
+
+    /// Take slot out of the heap (i.e. because it is about to be reused)
+    void remove(size_t slot);
+
+    /// @return the slot of the least recently heard node we are allowed to evict (leaving it in the heap), or -1 if none
+    int findOldest(const std::vector<meshtastic_NodeInfoLite> &nodes);
+
+  private:
+    static const uint16_t NOT_IN_HEAP = UINT16_MAX;
+
+    struct Entry {
+        uint32_t lastHeard; // the key we sorted by
+        uint16_t slot;
+    };
+
+    std::vector<Entry> heap;
+    std::vector<uint16_t> heapPos; // for each slot, its position in heap or NOT_IN_HEAP
+
+    void place(size_t pos, const Entry &e);
+    void siftUp(size_t pos), siftDown(size_t pos);
+};
@@ -447,12 +447,20 @@ void NodeDB::resetNodes()
     clearLocalPosition();
     numMeshNodes = 1;
     std::fill(devicestate.node_db_lite.begin() + 1, devicestate.node_db_lite.end(), meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
     saveDeviceStateToDisk();
     if (neighborInfoModule && moduleConfig.neighbor_info.enabled)
         neighborInfoModule->resetNeighbors();
 }
 
 void NodeDB::removeNodeByNum(NodeNum nodeNum)
+{
+    int removed = eraseMeshNode(nodeNum);
+    LOG_DEBUG("NodeDB::removeNodeByNum purged %d entries. Saving changes...\n", removed);
+    saveDeviceStateToDisk();
+}
+
+int NodeDB::eraseMeshNode(NodeNum nodeNum)
 {
     int newPos = 0, removed = 0;
     for (int i = 0; i < numMeshNodes; i++) {
@@ -464,8 +472,8 @@ void NodeDB::removeNodeByNum(NodeNum nodeNum)
     numMeshNodes -= removed;
     std::fill(devicestate.node_db_lite.begin() + numMeshNodes, devicestate.node_db_lite.begin() + numMeshNodes + 1,
               meshtastic_NodeInfoLite());
-    LOG_DEBUG("NodeDB::removeNodeByNum purged %d entries. Saving changes...\n", removed);
-    saveDeviceStateToDisk();
+    rebuildNodeIndex();
+    return removed;
 }
 
 void NodeDB::clearLocalPosition()
@@ -490,6 +498,7 @@ void NodeDB::cleanupMeshDB()
     numMeshNodes -= removed;
     std::fill(devicestate.node_db_lite.begin() + numMeshNodes, devicestate.node_db_lite.begin() + numMeshNodes + removed,
               meshtastic_NodeInfoLite());
+    rebuildNodeIndex();
     LOG_DEBUG("cleanupMeshDB purged %d entries\n", removed);
 }
 
@@ -500,6 +509,7 @@ void NodeDB::installDefaultDeviceState()
 
     numMeshNodes = 0;
     meshNodes = &devicestate.node_db_lite;
+    rebuildNodeIndex();
 
     // init our devicestate with valid flags so protobuf writing/reading will work
     devicestate.has_my_node = true;
@@ -608,6 +618,22 @@ void NodeDB::loadFromDisk()
         }
     }
     meshNodes->resize(MAX_NUM_NODES);
+    rebuildNodeIndex();
+
+    // Bring the snapshot up to date with whatever nodes changed after it was written
+    if (state == LoadFileResult::SUCCESS) {
+        nodeJournal.replay(
+            [this](const meshtastic_NodeInfoLite &n) {
+                meshtastic_NodeInfoLite *info = getOrCreateMeshNode(n.num);
+                if (info) {
+                    *info = n;
+                    updateNodeAge(info);
+                }
+            },
+            [this](NodeNum n) { eraseMeshNode(n); });
+    } else {
+        nodeJournal.clear(); // Any journal is relative to a snapshot we no longer have
+    }
 
     state = loadProto(configFileName, meshtastic_LocalConfig_size, sizeof(meshtastic_LocalConfig), &meshtastic_LocalConfig_msg,
                       &config);
@@ -737,10 +763,27 @@ void NodeDB::saveDeviceStateToDisk()
 #ifdef FSCom
     FSCom.mkdir("/prefs");
 #endif
+    // The new snapshot has every node change in it.  Drop the journal first, if we lose power before the snapshot is
+    // renamed into place we come back with the old snapshot, which is stale but consistent.
+    nodeJournal.clear();
     saveProto(prefFileName, sizeof(devicestate) + numMeshNodes * meshtastic_NodeInfoLite_size, &meshtastic_DeviceState_msg,
               &devicestate);
 }
 
+void NodeDB::saveNodesToDisk()
+{
+    if (nodeJournal.wantsSnapshot(numMeshNodes)) {
+        saveDeviceStateToDisk();
+        return;
+    }
+
+#ifdef FSCom
+    FSCom.mkdir("/prefs");
+#endif
+    if (!nodeJournal.flush([this](NodeNum n) -> const meshtastic_NodeInfoLite * { return getMeshNode(n); }))
+        saveDeviceStateToDisk();
+}
+
 void NodeDB::saveToDisk(int saveWhat)
 {
 #ifdef FSCom
@@ -875,6 +918,7 @@ void NodeDB::updatePosition(uint32_t nodeId, const meshtastic_Position &p, RxSou
             info->position.time = tmp_time;
     }
     info->has_position = true;
+    nodeJournal.markDirty(nodeId);
     updateGUIforNode = info;
     notifyObservers(true); // Force an update whether or not our node counts have changed
 }
@@ -898,6 +942,7 @@ void NodeDB::updateTelemetry(uint32_t nodeId, const meshtastic_Telemetry &t, RxS
     }
     info->device_metrics = t.variant.device_metrics;
     info->has_device_metrics = true;
+    nodeJournal.markDirty(nodeId);
     updateGUIforNode = info;
     notifyObservers(true); // Force an update whether or not our node counts have changed
 }
@@ -924,13 +969,14 @@ bool NodeDB::updateUser(uint32_t nodeId, const meshtastic_User &p, uint8_t chann
     info->has_user = true;
 
     if (changed) {
+        nodeJournal.markDirty(nodeId);
         updateGUIforNode = info;
         powerFSM.trigger(EVENT_NODEDB_UPDATED);
         notifyObservers(true); // Force an update whether or not our node counts have changed
 
-        // We just changed something about the user, store our DB
+        // We just changed something about the user, store the changed nodes
         Throttle::execute(
-            &lastNodeDbSave, ONE_MINUTE_MS, []() { nodeDB->saveToDisk(SEGMENT_DEVICESTATE); },
+            &lastNodeDbSave, ONE_MINUTE_MS, []() { nodeDB->saveNodesToDisk(); },
             []() { LOG_DEBUG("Deferring NodeDB saveToDisk for now, since we saved less than a minute ago\n"); });
     }
 
@@ -949,8 +995,10 @@ void NodeDB::updateFrom(const meshtastic_MeshPacket &mp)
             return;
         }
 
-        if (mp.rx_time) // if the packet has a valid timestamp use it to update our last_heard
+        if (mp.rx_time) { // if the packet has a valid timestamp use it to update our last_heard
             info->last_heard = mp.rx_time;
+            updateNodeAge(info);
+        }
 
         if (mp.rx_snr)
             info->snr = mp.rx_snr; // keep the most recent SNR we received for this node.
@@ -963,6 +1011,18 @@ void NodeDB::updateFrom(const meshtastic_MeshPacket &mp)
     }
 }
 
+bool NodeDB::setFavorite(NodeNum n, bool favorite)
+{
+    meshtastic_NodeInfoLite *info = getMeshNode(n);
+    if (!info)
+        return false;
+
+    info->is_favorite = favorite;
+    updateNodeAge(info);
+    nodeJournal.markDirty(n);
+    return true;
+}
+
 uint8_t NodeDB::getMeshNodeChannel(NodeNum n)
 {
     const meshtastic_NodeInfoLite *info = getMeshNode(n);
@@ -976,9 +1036,9 @@ uint8_t NodeDB::getMeshNodeChannel(NodeNum n)
 /// NOTE: This function might be called from an ISR
 meshtastic_NodeInfoLite *NodeDB::getMeshNode(NodeNum n)
 {
-    for (int i = 0; i < numMeshNodes; i++)
-        if (meshNodes->at(i).num == n)
-            return &meshNodes->at(i);
+    int slot = nodeIndex.find(n, *meshNodes);
+    if (slot >= 0 && slot < numMeshNodes)
+        return &meshNodes->at(slot);
 
     return NULL;
 }
@@ -989,31 +1049,32 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
     meshtastic_NodeInfoLite *lite = getMeshNode(n);
 
     if (!lite) {
+        size_t slot;
         if ((numMeshNodes >= MAX_NUM_NODES) || (memGet.getFreeHeap() < meshtastic_NodeInfoLite_size * 3)) {
             if (screen)
                 screen->print("Warn: node database full!\nErasing oldest entry\n");
             LOG_WARN("Node database full! Erasing oldest entry\n");
-            // look for oldest node and erase it
-            uint32_t oldest = UINT32_MAX;
-            int oldestIndex = -1;
-            for (int i = 1; i < numMeshNodes; i++) {
-                if (!meshNodes->at(i).is_favorite && meshNodes->at(i).last_heard < oldest) {
-                    oldest = meshNodes->at(i).last_heard;
-                    oldestIndex = i;
-                }
+            // find the oldest node and reuse its slot
+            int oldestIndex = ageIndex.findOldest(*meshNodes);
+            if (oldestIndex < 0) {
+                LOG_ERROR("Every node is a favorite, can't make room for 0x%x\n", n);
+                return NULL;
             }
-            // Shove the remaining nodes down the chain
-            for (int i = oldestIndex; i < numMeshNodes - 1; i++) {
-                meshNodes->at(i) = meshNodes->at(i + 1);
-            }
-            (numMeshNodes)--;
+            slot = oldestIndex;
+            NodeNum oldest = meshNodes->at(slot).num;
+            nodeJournal.markDirty(oldest);
+            nodeIndex.remove(oldest, *meshNodes);
+        } else {
+            // add the node at the end
+            slot = (numMeshNodes)++;
         }
-        // add the node at the end
-        lite = &meshNodes->at((numMeshNodes)++);
+        lite = &meshNodes->at(slot);
 
         // everything is missing except the nodenum
         memset(lite, 0, sizeof(*lite));
         lite->num = n;
+        nodeIndex.insert(n, slot);
+        updateNodeAge(lite);
     }
 
     return lite;
@@ -6,6 +6,9 @@
 #include <vector>
 
 #include "MeshTypes.h"
+#include "NodeAgeIndex.h"
+#include "NodeIndex.h"
+#include "NodeJournal.h"
 #include "NodeStatus.h"
 #include "mesh-pb-constants.h"
 #include "mesh/generated/meshtastic/mesh.pb.h" // For CriticalErrorCode
@@ -75,6 +78,9 @@ class NodeDB
     void saveToDisk(int saveWhat = SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_DEVICESTATE | SEGMENT_CHANNELS),
         saveChannelsToDisk(), saveDeviceStateToDisk();
 
+    /// write just the nodes that changed since our last save to flash (falls back to saveDeviceStateToDisk when needed)
+    void saveNodesToDisk();
+
     /** Reinit radio config if needed, because either:
      * a) sometimes a buggy android app might send us bogus settings or
      * b) the client set factory_reset
@@ -145,6 +151,9 @@ class NodeDB
     meshtastic_NodeInfoLite *getMeshNode(NodeNum n);
     size_t getNumMeshNodes() { return numMeshNodes; }
 
+    /// Mark or unmark a node as a favorite (favorites are never evicted when the DB is full), return false if not found
+    bool setFavorite(NodeNum n, bool favorite);
+
     void clearLocalPosition();
 
     void setLocalPosition(meshtastic_Position position, bool timeOnly = false)
@@ -160,14 +169,60 @@ class NodeDB
         localPosition = position;
     }
 
+    /// Until endBatch(), hold back notifying our observers (i.e. the screen) of changes, a burst of packets updating many
+    /// nodes then only costs one notification
+    void beginBatch() { inBatch = true; }
+
+    /// Send the notification (if any) held back since beginBatch()
+    void endBatch()
+    {
+        inBatch = false;
+        if (batchNotifyPending) {
+            batchNotifyPending = false;
+            notifyObservers(batchForceUpdate);
+            batchForceUpdate = false;
+        }
+    }
+
   private:
     uint32_t lastNodeDbSave = 0; // when we last saved our db to flash
+
+    bool inBatch = false, batchNotifyPending = false, batchForceUpdate = false;
+
+    /// NodeNum -> meshNodes slot, so getMeshNode doesn't need to scan the whole DB
+    NodeIndex nodeIndex;
+
+    /// Our nodes (other than ourselves and favorites) ordered by last_heard, so we know who to evict when full
+    NodeAgeIndex ageIndex;
+
+    /// Reindex meshNodes, must be called whenever nodes are removed or moved around in the array
+    void rebuildNodeIndex()
+    {
+        nodeIndex.rebuild(*meshNodes, numMeshNodes, MAX_NUM_NODES);
+        ageIndex.rebuild(*meshNodes, numMeshNodes, MAX_NUM_NODES);
+    }
+
+    /// Call after changing the last_heard or is_favorite of a node, so we still evict the right one
+    void updateNodeAge(const meshtastic_NodeInfoLite *info) { ageIndex.update(*meshNodes, info - meshNodes->data()); }
+
+    /// The node changes we have made since devicestate was last written to flash
+    NodeJournal nodeJournal;
+
+    /// Remove a node from meshNodes (without saving), return the number of entries removed
+    int eraseMeshNode(NodeNum nodeNum);
+
     /// Find a node in our DB, create an empty NodeInfoLite if missing
     meshtastic_NodeInfoLite *getOrCreateMeshNode(NodeNum n);
 
     /// Notify observers of changes to the DB
     void notifyObservers(bool forceUpdate = false)
     {
+        if (inBatch) {
+            batchForceUpdate = batchForceUpdate || forceUpdate;
+            batchNotifyPending = true;
+            return;
+        }
+
         // Notify observers of the current node state
         const meshtastic::NodeStatus status = meshtastic::NodeStatus(getNumOnlineMeshNodes(), getNumMeshNodes(), forceUpdate);
         newStatus.notifyObservers(&status);
@@ -0,0 +1,79 @@
+#include "NodeIndex.h"
+#include "configuration.h"
+
+const uint16_t NodeIndex::EMPTY_BUCKET;
+
+void NodeIndex::clear(size_t maxNodes)
+{
+    // Keep the table at most half full
+    size_t wanted = 2;
+    uint8_t bits = 1;
+    while (wanted < maxNodes * 2) {
+        wanted <<= 1;
+        bits++;
+    }
+
+    if (buckets.size() != wanted) {
+        buckets.resize(wanted);
+        mask = wanted - 1;
+        shift = 32 - bits;
+    }
+    std::fill(buckets.begin(), buckets.end(), EMPTY_BUCKET);
+}
+
+void NodeIndex::rebuild(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t count, size_t maxNodes)
+{
+    clear(maxNodes);
+    for (size_t i = 0; i < count; i++)
+        insert(nodes[i].num, i);
+}
+
+void NodeIndex::insert(NodeNum n, size_t slot)
+{
+    if (buckets.empty() || slot >= EMPTY_BUCKET) {
+        LOG_ERROR("NodeIndex can't hold slot %u\n", (unsigned)slot);
+        return;
+    }
+
+    uint32_t b = bucketFor(n);
+    while (buckets[b] != EMPTY_BUCKET)
+        b = (b + 1) & mask;
+    buckets[b] = slot;
+}
+
+void NodeIndex::remove(NodeNum n, const std::vector<meshtastic_NodeInfoLite> &nodes)
+{
+    int slot = find(n, nodes);
+    if (slot < 0)
+        return;
+
+    uint32_t b = bucketFor(n);
+    while (buckets[b] != slot)
+        b = (b + 1) & mask;
+
+    // Backward shift deletion, so we don't need tombstones: pull later members of this probe chain into the hole
+    for (uint32_t j = (b + 1) & mask; buckets[j] != EMPTY_BUCKET; j = (j + 1) & mask) {
+        uint32_t home = bucketFor(nodes[buckets[j]].num);
+        bool homeBetween = (b <= j) ? (b < home && home <= j) : (b < home || home <= j);
+        if (!homeBetween) {
+            buckets[b] = buckets[j];
+            b = j;
+        }
+    }
+    buckets[b] = EMPTY_BUCKET;
+}
+
+int NodeIndex::find(NodeNum n, const std::vector<meshtastic_NodeInfoLite> &nodes) const
+{
+    if (buckets.empty())
+        return -1;
+
+    // The table is never more than half full, so we always hit an empty bucket eventually
+    for (uint32_t b = bucketFor(n);; b = (b + 1) & mask) {
+        uint16_t slot = buckets[b];
+        if (slot == EMPTY_BUCKET)
+            return -1;
+        if (slot < nodes.size() && nodes[slot].num == n)
+            return slot;
+    }
+}
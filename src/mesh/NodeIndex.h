@@ -0,0 +1,47 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include <vector>
+
+/**
+ * A compact open-addressing hash index from NodeNum to a slot in the NodeDB node array.
+ *
+ * Each bucket only holds a 16 bit slot number, the key itself is read back from the node array while probing, so the
+ * index costs two bytes per bucket.  The bucket count is kept at a power of two of at least twice the node capacity
+ * so probe chains stay short.
+ *
+ * Removing a node from the middle of the array renumbers every later slot, so that is handled by rebuilding the whole
+ * index.  A slot that is reused in place just has its old node removed first.
+ */
+class NodeIndex
+{
+  public:
+    /// Forget every entry and make sure we have enough buckets for maxNodes entries
+    void clear(size_t maxNodes);
+
+    /// Index the first count entries of nodes
+    void rebuild(const std::vector<meshtastic_NodeInfoLite> &nodes, size_t count, size_t maxNodes);
+
+    /// Record that node n now lives at slot
+    void insert(NodeNum n, size_t slot);
+
+    /// Forget node n, must be called while nodes still holds n at its slot
+    void remove(NodeNum n, const std::vector<meshtastic_NodeInfoLite> &nodes);
+
+    /// @return the slot holding node n, or -1 if it is not in the index
+    /// NOTE: This function might be called from an ISR
+    int find(NodeNum n, const std::vector<meshtastic_NodeInfoLite> &nodes) const;
+
+  private:
+    static const uint16_t EMPTY_BUCKET = UINT16_MAX;
+
+    std::vector<uint16_t> buckets;
+    uint32_t mask = 0;
+    uint8_t shift = 32;
+
+    uint32_t bucketFor(NodeNum n) const
+    {
+        // Fibonacci hashing, take the top bits of the product so every bit of the nodenum contributes
+        return ((uint32_t)(n * 2654435769UL)) >> shift;
+    }
+};
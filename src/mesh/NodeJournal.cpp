@@ -0,0 +1,130 @@
+#include "NodeJournal.h"
+#include "FSCommon.h"
+#include "configuration.h"
+#include "mesh-pb-constants.h"
+#include <algorithm>
+#include <pb_decode.h>
+#include <pb_encode.h>
+
+static const char *journalFileName = "/prefs/nodes.journal";
+
+void NodeJournal::markDirty(NodeNum n)
+{
+    if (dirty.size() > NODE_JOURNAL_MAX_DIRTY)
+        return; // we are going to write a whole snapshot anyways
+
+    if (std::find(dirty.begin(), dirty.end(), n) == dirty.end())
+        dirty.push_back(n);
+}
+
+bool NodeJournal::wantsSnapshot(size_t numNodes) const
+{
+    // Once replaying the journal reads more than the snapshot itself would, it has stopped paying for itself
+    size_t pending = journalSize + dirty.size() * meshtastic_NodeInfoLite_size;
+    return broken || dirty.size() > NODE_JOURNAL_MAX_DIRTY || pending > NODE_JOURNAL_MAX_SIZE ||
+           pending > numNodes * meshtastic_NodeInfoLite_size;
+}
+
+bool NodeJournal::flush(std::function<const meshtastic_NodeInfoLite *(NodeNum)> lookup)
+{
+    if (dirty.empty())
+        return true;
+
+    bool okay = false;
+#ifdef FSCom
+    auto f = FSCom.open(journalFileName, FILE_O_APPEND);
+    if (f) {
+        LOG_INFO("Appending %u node changes to %s\n", dirty.size(), journalFileName);
+        pb_ostream_t stream = {&writecb, &f, SIZE_MAX};
+
+        okay = true;
+        for (NodeNum n : dirty) {
+            const meshtastic_NodeInfoLite *node = lookup(n);
+            uint8_t kind = node ? NODE_UPDATED : NODE_REMOVED;
+
+            okay = pb_write(&stream, &kind, sizeof(kind));
+            if (okay && node)
+                okay = pb_encode_ex(&stream, &meshtastic_NodeInfoLite_msg, node, PB_ENCODE_DELIMITED);
+            else if (okay)
+                okay = pb_write(&stream, (const uint8_t *)&n, sizeof(n));
+
+            if (!okay) {
+                LOG_ERROR("Error: can't append to %s %s\n", journalFileName, PB_GET_ERROR(&stream));
+                broken = true; // we might have left a partial record behind
+                break;
+            }
+        }
+        f.flush();
+        f.close();
+
+        journalSize += stream.bytes_written;
+    } else {
+        LOG_ERROR("Can't open %s\n", journalFileName);
+    }
+#endif
+
+    if (okay)
+        dirty.clear();
+    return okay;
+}
+
+size_t NodeJournal::replay(std::function<void(const meshtastic_NodeInfoLite &)> upsert, std::function<void(NodeNum)> remove)
+{
+    size_t numRecords = 0;
+    journalSize = 0;
+#ifdef FSCom
+    if (!FSCom.exists(journalFileName))
+        return 0;
+
+    auto f = FSCom.open(journalFileName, FILE_O_READ);
+    if (!f) {
+        LOG_ERROR("Could not open / read %s\n", journalFileName);
+        broken = true;
+        return 0;
+    }
+
+    journalSize = f.size();
+    pb_istream_t stream = {&readcb, &f, journalSize};
+    while (stream.bytes_left > 0) {
+        uint8_t kind = 0;
+        bool okay = pb_read(&stream, &kind, sizeof(kind));
+
+        if (okay && kind == NODE_UPDATED) {
+            meshtastic_NodeInfoLite node = meshtastic_NodeInfoLite_init_default;
+            okay = pb_decode_ex(&stream, &meshtastic_NodeInfoLite_msg, &node, PB_DECODE_DELIMITED);
+            if (okay)
+                upsert(node);
+        } else if (okay && kind == NODE_REMOVED) {
+            NodeNum n;
+            okay = pb_read(&stream, (uint8_t *)&n, sizeof(n));
+            if (okay)
+                remove(n);
+        } else {
+            okay = false;
+        }
+
+        if (!okay) {
+            // Probably power was lost partway through an append, everything before this record is still good
+            LOG_WARN("Ignoring the tail of %s after %u records\n", journalFileName, numRecords);
+            broken = true; // anything we appended now would be lost behind the torn record
+            break;
+        }
+        numRecords++;
+    }
+    f.close();
+
+    LOG_INFO("Replayed %u node changes from %s\n", numRecords, journalFileName);
+#endif
+    return numRecords;
+}
+
+void NodeJournal::clear()
+{
+    dirty.clear();
+    journalSize = 0;
+    broken = false;
+#ifdef FSCom
+    if (FSCom.exists(journalFileName) && !FSCom.remove(journalFileName))
+        LOG_WARN("Can't remove old node journal\n");
+#endif
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include <functional>
+#include <vector>
+
+/// Once the journal is this big we rewrite the whole devicestate instead of appending to it
+#ifndef NODE_JOURNAL_MAX_SIZE
+#define NODE_JOURNAL_MAX_SIZE (8 * 1024)
+#endif
+
+/// If more nodes than this change between flushes, a full devicestate rewrite is cheaper than journaling them all
+#ifndef NODE_JOURNAL_MAX_DIRTY
+#define NODE_JOURNAL_MAX_DIRTY 32
+#endif
+
+/**
+ * An append only log of node changes made since the devicestate (our base snapshot) was last written to flash.
+ *
+ * NodeDB marks nodes dirty as it changes them, a flush then appends one record per dirty node: either the node's current
+ * NodeInfoLite or a note that the node is gone.  So a flush costs flash writes proportional to what changed, rather than
+ * rewriting every node we know.  At boot the records are replayed on top of the snapshot, later records win.
+ *
+ * Once the journal grows past the point where replaying it costs more than a fresh snapshot, wantsSnapshot() tells NodeDB
+ * to write a whole new devicestate, which empties the journal again.
+ */
+class NodeJournal
+{
+  public:
+    /// Remember that node n was changed (or removed), so the next flush records it
+    void markDirty(NodeNum n);
+
+    /// @return true if there is something to flush
+    bool hasChanges() const { return !dirty.empty(); }
+
+    /// @return true if a full snapshot of numNodes nodes would now be cheaper than appending to the journal
+    bool wantsSnapshot(size_t numNodes) const;
+
+    /**
+     * Append a record for every dirty node.  lookup returns the current state of a node, or NULL if it was removed.
+     *
+     * @return false if we couldn't write the journal, the caller should fall back to a full snapshot
+     */
+    bool flush(std::function<const meshtastic_NodeInfoLite *(NodeNum)> lookup);
+
+    /**
+     * Apply every record in the journal, in the order it was written
+     *
+     * @return the number of records replayed
+     */
+    size_t replay(std::function<void(const meshtastic_NodeInfoLite &)> upsert, std::function<void(NodeNum)> remove);
+
+    /// Forget the journal, called once everything in it is part of a new snapshot
+    void clear();
+
+  private:
+    enum RecordKind : uint8_t { NODE_UPDATED = 1, NODE_REMOVED = 2 };
+
+    std::vector<NodeNum> dirty;
+
+    /// How many bytes are in the journal file
+    size_t journalSize = 0;
+
+    /// Set if the journal can't be trusted to be appended to (i.e. it ends in a torn record), so we must snapshot
+    bool broken = false;
+};
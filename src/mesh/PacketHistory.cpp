@@ -6,10 +6,38 @@
 #include "platform/portduino/PortduinoGlue.h"
 #endif
 
+/// How many msecs of history each time bucket covers
+#define BUCKET_WIDTH_MSEC (FLOOD_EXPIRE_TIME / PACKET_HISTORY_BUCKETS)
+
+const uint16_t PacketHistory::NO_RECORD;
+
 PacketHistory::PacketHistory()
 {
-    recentPackets.reserve(MAX_NUM_NODES); // Prealloc the worst case # of records - to prevent heap fragmentation
-                                          // setup our periodic task
+    // Prealloc the worst case # of records - to prevent heap fragmentation
+    records = new PacketRecord[PACKET_HISTORY_SIZE];
+
+    // Keep the hash at most half full so probe chains stay short
+    uint32_t hashSize = 2;
+    while (hashSize < PACKET_HISTORY_SIZE * 2)
+        hashSize <<= 1;
+    hashTable = new uint16_t[hashSize];
+    hashMask = hashSize - 1;
+    for (uint32_t i = 0; i < hashSize; i++)
+        hashTable[i] = NO_RECORD;
+
+    for (uint16_t i = 0; i < PACKET_HISTORY_SIZE; i++)
+        records[i].next = (i + 1 < PACKET_HISTORY_SIZE) ? i + 1 : NO_RECORD;
+    freeList = 0;
+
+    for (uint16_t i = 0; i < NUM_TIME_SLOTS; i++)
+        timeSlots[i] = NO_RECORD;
+    currentSlotStart = millis();
+}
+
+PacketHistory::~PacketHistory()
+{
+    delete[] records;
+    delete[] hashTable;
 }
 
 /**
@@ -23,58 +51,165 @@ bool PacketHistory::wasSeenRecently(const meshtastic_MeshPacket *p, bool withUpd
     }
 
     uint32_t now = millis();
+    clearExpiredRecentPackets(now);
 
-    PacketRecord r;
-    r.id = p->id;
-    r.sender = getFrom(p);
-    r.rxTimeMsec = now;
-
-    auto found = recentPackets.find(r);
-    bool seenRecently = (found != recentPackets.end()); // found not equal to .end() means packet was seen recently
+    NodeNum sender = getFrom(p);
+    uint16_t found = find(sender, p->id);
+    bool seenRecently = (found != NO_RECORD);
 
-    if (seenRecently && (now - found->rxTimeMsec) >= FLOOD_EXPIRE_TIME) { // Check whether found packet has already expired
-        recentPackets.erase(found);                                       // Erase and pretend packet has not been seen recently
-        found = recentPackets.end();
+    if (seenRecently && (now - records[found].rxTimeMsec) >= FLOOD_EXPIRE_TIME) { // Check whether found packet has expired
+        remove(found); // Erase and pretend packet has not been seen recently
+        found = NO_RECORD;
         seenRecently = false;
     }
 
     if (seenRecently) {
         LOG_DEBUG("Found existing packet record for fr=0x%x,to=0x%x,id=0x%x\n", p->from, p->to, p->id);
+        numHits++;
+    } else {
+        numMisses++;
     }
 
     if (withUpdate) {
-        if (found != recentPackets.end()) { // delete existing to updated timestamp (re-insert)
-            recentPackets.erase(found);     // as unsorted_set::iterator is const (can't update timestamp - so re-insert..)
+        if (found != NO_RECORD) { // refresh the timestamp, which moves the record into the newest time bucket
+            unlink(found);
+            records[found].rxTimeMsec = now;
+            linkToCurrentSlot(found);
+        } else {
+            insert(sender, p->id, now);
         }
-        recentPackets.insert(r);
         printPacket("Add packet record", p);
     }
 
-    // Capacity is reerved, so only purge expired packets if recentPackets fills past 90% capacity
-    // Expiry is normally dealt with after having searched/found a packet (above)
-    if (recentPackets.size() > (MAX_NUM_NODES * 0.9)) {
-        clearExpiredRecentPackets();
+    return seenRecently;
+}
+
+const PacketRecord *PacketHistory::countDuplicate(const meshtastic_MeshPacket *p)
+{
+    uint16_t found = find(getFrom(p), p->id);
+    if (found == NO_RECORD)
+        return NULL;
+
+    PacketRecord &r = records[found];
+    if (r.numDuplicates < UINT8_MAX)
+        r.numDuplicates++;
+
+    int8_t snr = p->rx_snr < INT8_MIN ? INT8_MIN : (p->rx_snr > INT8_MAX ? INT8_MAX : (int8_t)p->rx_snr);
+    if (snr > r.maxDuplicateSnr)
+        r.maxDuplicateSnr = snr;
+    return &r;
+}
+
+uint32_t PacketHistory::hashOf(NodeNum sender, PacketId id) const
+{
+    uint32_t h = sender ^ (id * 0x9E3779B1UL);
+    h ^= h >> 16;
+    h *= 0x85EBCA6BUL;
+    h ^= h >> 13;
+    return h & hashMask;
+}
+
+uint16_t PacketHistory::find(NodeNum sender, PacketId id) const
+{
+    // The table is never more than half full, so we always hit an empty bucket eventually
+    for (uint32_t i = hashOf(sender, id);; i = (i + 1) & hashMask) {
+        uint16_t r = hashTable[i];
+        if (r == NO_RECORD || (records[r].sender == sender && records[r].id == id))
+            return r;
     }
+}
 
-    return seenRecently;
+void PacketHistory::insert(NodeNum sender, PacketId id, uint32_t now)
+{
+    if (freeList == NO_RECORD) {
+        // Out of records, sacrifice one from the oldest time bucket (the current bucket is the last resort)
+        for (uint16_t i = 1; i <= NUM_TIME_SLOTS; i++) {
+            uint16_t slot = (currentSlot + i) % NUM_TIME_SLOTS;
+            if (timeSlots[slot] != NO_RECORD) {
+                remove(timeSlots[slot]);
+                numEvictions++;
+                break;
+            }
+        }
+    }
+
+    uint16_t r = freeList;
+    freeList = records[r].next;
+
+    records[r].sender = sender;
+    records[r].id = id;
+    records[r].rxTimeMsec = now;
+    records[r].numDuplicates = 0;
+    records[r].maxDuplicateSnr = INT8_MIN;
+    linkToCurrentSlot(r);
+
+    uint32_t i = hashOf(sender, id);
+    while (hashTable[i] != NO_RECORD)
+        i = (i + 1) & hashMask;
+    hashTable[i] = r;
+}
+
+void PacketHistory::remove(uint16_t r)
+{
+    uint32_t i = hashOf(records[r].sender, records[r].id);
+    while (hashTable[i] != r)
+        i = (i + 1) & hashMask;
+
+    // Backward shift deletion, so we don't need tombstones: pull later members of this probe chain into the hole
+    for (uint32_t j = (i + 1) & hashMask; hashTable[j] != NO_RECORD; j = (j + 1) & hashMask) {
+        uint32_t home = hashOf(records[hashTable[j]].sender, records[hashTable[j]].id);
+        bool homeBetween = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (!homeBetween) {
+            hashTable[i] = hashTable[j];
+            i = j;
+        }
+    }
+    hashTable[i] = NO_RECORD;
+
+    unlink(r);
+    records[r].next = freeList;
+    freeList = r;
+}
+
+void PacketHistory::linkToCurrentSlot(uint16_t r)
+{
+    uint16_t slot = currentSlot;
+    records[r].timeSlot = slot;
+    records[r].prev = NO_RECORD;
+    records[r].next = timeSlots[slot];
+    if (timeSlots[slot] != NO_RECORD)
+        records[timeSlots[slot]].prev = r;
+    timeSlots[slot] = r;
+}
+
+void PacketHistory::unlink(uint16_t r)
+{
+    PacketRecord &rec = records[r];
+    if (rec.prev != NO_RECORD)
+        records[rec.prev].next = rec.next;
+    else
+        timeSlots[rec.timeSlot] = rec.next;
+    if (rec.next != NO_RECORD)
+        records[rec.next].prev = rec.prev;
 }
 
 /**
- * Iterate through all recent packets, and remove all older than FLOOD_EXPIRE_TIME
+ * Advance our ring of time buckets, every bucket we step into is reused so all of its (now expired) records are freed
  */
-void PacketHistory::clearExpiredRecentPackets()
+void PacketHistory::clearExpiredRecentPackets(uint32_t now)
 {
-    uint32_t now = millis();
+    uint32_t steps = (now - currentSlotStart) / BUCKET_WIDTH_MSEC;
+    if (steps == 0)
+        return;
+    currentSlotStart += steps * BUCKET_WIDTH_MSEC;
 
-    LOG_DEBUG("recentPackets size=%ld\n", recentPackets.size());
+    // After a long idle period every bucket is stale, no need to walk the ring more than once
+    if (steps > NUM_TIME_SLOTS)
+        steps = NUM_TIME_SLOTS;
 
-    for (auto it = recentPackets.begin(); it != recentPackets.end();) {
-        if ((now - it->rxTimeMsec) >= FLOOD_EXPIRE_TIME) {
-            it = recentPackets.erase(it); // erase returns iterator pointing to element immediately following the one erased
-        } else {
-            ++it;
-        }
+    for (uint32_t i = 0; i < steps; i++) {
+        currentSlot = (currentSlot + 1) % NUM_TIME_SLOTS;
+        while (timeSlots[currentSlot] != NO_RECORD)
+            remove(timeSlots[currentSlot]);
     }
-
-    LOG_DEBUG("recentPackets size=%ld (after clearing expired packets)\n", recentPackets.size());
-}
\ No newline at end of file
+}
@@ -1,40 +1,87 @@
 #pragma once
 
 #include "Router.h"
-#include <unordered_set>
+#include "configuration.h"
 
 /// We clear our old flood record 10 minutes after we see the last of it
 #define FLOOD_EXPIRE_TIME (10 * 60 * 1000L)
 
+/// Max number of packet records we remember, each one costs about 20 bytes of RAM
+#ifndef PACKET_HISTORY_SIZE
+#if defined(ARCH_PORTDUINO)
+#define PACKET_HISTORY_SIZE 2048
+#elif defined(ARCH_ESP32)
+#define PACKET_HISTORY_SIZE 512
+#elif defined(ARCH_NRF52)
+#define PACKET_HISTORY_SIZE 256
+#else
+#define PACKET_HISTORY_SIZE 128
+#endif
+#endif
+
+static_assert(PACKET_HISTORY_SIZE < UINT16_MAX, "PacketHistory records are indexed with 16 bits");
+
+/// FLOOD_EXPIRE_TIME is split into this many time buckets, records are expired a whole bucket at a time
+#define PACKET_HISTORY_BUCKETS 8
+
 /**
  * A record of a recent message broadcast
  */
 struct PacketRecord {
     NodeNum sender;
     PacketId id;
-    uint32_t rxTimeMsec; // Unix time in msecs - the time we received it
+    uint32_t rxTimeMsec;    // Unix time in msecs - the time we received it
+    uint16_t prev, next;    // our neighbours in the time bucket (or free) list we are on
+    uint8_t timeSlot;       // which time bucket list we are on
+    uint8_t numDuplicates;  // copies of it we heard after the first (stops counting at UINT8_MAX)
+    int8_t maxDuplicateSnr; // the best SNR we heard any of those copies at
 
     bool operator==(const PacketRecord &p) const { return sender == p.sender && id == p.id; }
 };
 
-class PacketRecordHashFunction
-{
-  public:
-    size_t operator()(const PacketRecord &p) const { return (std::hash<NodeNum>()(p.sender)) ^ (std::hash<PacketId>()(p.id)); }
-};
-
 /**
  * This is a mixin that adds a record of past packets we have seen
+ *
+ * Records live in a fixed array that is allocated once.  A compact open addressing hash of (sender, id) finds them, and
+ * every record is also linked into the time bucket of when we last saw it.  As time moves on whole buckets fall off the
+ * end of the ring and all of their records are freed, so expiry is O(1) per record instead of a full table sweep.
+ * If we run out of records before they expire, we evict the oldest bucket's records first.
  */
 class PacketHistory
 {
   private:
-    std::unordered_set<PacketRecord, PacketRecordHashFunction> recentPackets;
+    static const uint16_t NO_RECORD = UINT16_MAX;
+    static const uint16_t NUM_TIME_SLOTS = PACKET_HISTORY_BUCKETS + 1; // one extra for the bucket currently filling
+
+    PacketRecord *records;
+    uint16_t *hashTable; // index into records, sized to twice the number of records
+    uint32_t hashMask;
+    uint16_t freeList = NO_RECORD;
+    uint16_t timeSlots[NUM_TIME_SLOTS]; // head of the record list for each time bucket
+    uint16_t currentSlot = 0;           // the time bucket that is currently filling
+    uint32_t currentSlotStart;          // millis() when currentSlot started filling
+
+    uint32_t numHits = 0, numMisses = 0, numEvictions = 0;
+
+    uint32_t hashOf(NodeNum sender, PacketId id) const;
+
+    /// @return the index of the record for (sender, id) or NO_RECORD
+    uint16_t find(NodeNum sender, PacketId id) const;
 
-    void clearExpiredRecentPackets(); // clear all recentPackets older than FLOOD_EXPIRE_TIME
+    /// Add a new record (the caller must have checked it isn't already present)
+    void insert(NodeNum sender, PacketId id, uint32_t now);
+
+    /// Drop a record from both the hash and its time bucket and return it to the free list
+    void remove(uint16_t r);
+
+    void linkToCurrentSlot(uint16_t r), unlink(uint16_t r);
+
+    /// Free the records of any time buckets which are now older than FLOOD_EXPIRE_TIME
+    void clearExpiredRecentPackets(uint32_t now);
 
   public:
     PacketHistory();
+    ~PacketHistory();
 
     /**
      * Update recentBroadcasts and return true if we have already seen this packet
@@ -42,4 +89,20 @@ class PacketHistory
      * @param withUpdate if true and not found we add an entry to recentPackets
      */
     bool wasSeenRecently(const meshtastic_MeshPacket *p, bool withUpdate = true);
+
+    /**
+     * Count p as another copy of a packet we already have a record of
+     *
+     * @return its updated record, or NULL if we have none
+     */
+    const PacketRecord *countDuplicate(const meshtastic_MeshPacket *p);
+
+    /// Number of lookups that found an unexpired record
+    uint32_t getNumHits() const { return numHits; }
+
+    /// Number of lookups that found nothing
+    uint32_t getNumMisses() const { return numMisses; }
+
+    /// Number of records we had to throw away before they expired because the history was full
+    uint32_t getNumEvictions() const { return numEvictions; }
 };
@@ -0,0 +1,107 @@
+#include "PacketTrace.h"
+#include "concurrency/LockGuard.h"
+#include "configuration.h"
+#include <stdarg.h>
+
+PacketTrace packetTrace;
+
+void PacketTrace::add(const char *event, const meshtastic_MeshPacket *p)
+{
+    concurrency::LockGuard g(&lock);
+
+    Record &r = records[numAdded % PACKET_TRACE_SIZE];
+    r.msec = millis();
+    r.event = event;
+    r.from = p->from;
+    r.to = p->to;
+    r.id = p->id;
+    r.rxSnr = p->rx_snr;
+    r.hopLimit = p->hop_limit;
+    r.hopStart = p->hop_start;
+    r.channel = p->channel;
+    r.flags = (p->want_ack ? WANT_ACK : 0) | (p->via_mqtt ? VIA_MQTT : 0);
+    if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
+        r.flags |= DECODED | (p->decoded.want_response ? WANT_RESPONSE : 0);
+        r.portnum = p->decoded.portnum;
+    } else {
+        r.portnum = 0;
+    }
+    numAdded++;
+}
+
+size_t PacketTrace::size()
+{
+    concurrency::LockGuard g(&lock);
+    return numAdded < PACKET_TRACE_SIZE ? numAdded : PACKET_TRACE_SIZE;
+}
+
+bool PacketTrace::format(size_t index, char *buf, size_t bufLen)
+{
+    Record r;
+    {
+        concurrency::LockGuard g(&lock);
+        size_t n = numAdded < PACKET_TRACE_SIZE ? numAdded : PACKET_TRACE_SIZE;
+        if (index >= n)
+            return false;
+        r = records[(numAdded - n + index) % PACKET_TRACE_SIZE];
+    }
+    formatRecord(r, buf, bufLen);
+    return true;
+}
+
+void PacketTrace::flush()
+{
+#ifdef DEBUG_PORT
+    char line[160];
+    for (;;) {
+        Record r;
+        uint32_t numLost = 0;
+        {
+            concurrency::LockGuard g(&lock);
+            if (numFlushed == numAdded)
+                return;
+            if (numAdded - numFlushed > PACKET_TRACE_SIZE) {
+                numLost = numAdded - numFlushed - PACKET_TRACE_SIZE;
+                numFlushed += numLost;
+            }
+            r = records[numFlushed++ % PACKET_TRACE_SIZE];
+        }
+        if (numLost)
+            LOG_DEBUG("Packet trace overflowed, %u events were not logged\n", numLost);
+        formatRecord(r, line, sizeof(line));
+        LOG_DEBUG("%s\n", line);
+    }
+#endif
+}
+
+/// printf fmt onto the end of the n chars already in buf, n is left at bufLen once it is full
+static void appendf(char *buf, size_t bufLen, size_t &n, const char *fmt, ...)
+{
+    if (n >= bufLen)
+        return;
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(buf + n, bufLen - n, fmt, args);
+    va_end(args);
+    if (len > 0)
+        n = (n + len < bufLen) ? n + len : bufLen;
+}
+
+void PacketTrace::formatRecord(const Record &r, char *buf, size_t bufLen)
+{
+    size_t n = 0;
+    appendf(buf, bufLen, n, "[%u] %s (id=0x%08x fr=0x%02x to=0x%02x, WantAck=%d, HopLim=%d Ch=0x%x", r.msec, r.event, r.id,
+            r.from & 0xff, r.to & 0xff, (r.flags & WANT_ACK) ? 1 : 0, r.hopLimit, r.channel);
+    if (r.flags & DECODED)
+        appendf(buf, bufLen, n, " Portnum=%d%s", r.portnum, (r.flags & WANT_RESPONSE) ? " WANTRESP" : "");
+    else
+        appendf(buf, bufLen, n, " encrypted");
+    if (r.rxSnr != 0.0)
+        appendf(buf, bufLen, n, " rxSNR=%g", r.rxSnr);
+    if (r.flags & VIA_MQTT)
+        appendf(buf, bufLen, n, " via MQTT");
+    if (r.hopStart != 0)
+        appendf(buf, bufLen, n, " hopStart=%d", r.hopStart);
+    appendf(buf, bufLen, n, ")");
+}
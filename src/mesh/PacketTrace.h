@@ -0,0 +1,64 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "concurrency/Lock.h"
+
+/// Number of packet events we remember, each one costs about 32 bytes of RAM
+#ifndef PACKET_TRACE_SIZE
+#if defined(ARCH_PORTDUINO) || defined(ARCH_ESP32)
+#define PACKET_TRACE_SIZE 64
+#else
+#define PACKET_TRACE_SIZE 32
+#endif
+#endif
+
+/**
+ * A ring of the most recent packet events (received, enqueued, decoded, sent...), as used to be logged by printPacket().
+ *
+ * Recording an event only copies a few fields of the packet into a fixed size record, none of the text is built until
+ * someone reads the ring: flush() logs the events nobody has seen yet (the main loop calls it when idle), format() turns
+ * any one record into text.  So a busy node doesn't pay for string building and log output on every packet it handles.
+ *
+ * If events arrive faster than they are flushed the oldest are overwritten, flush() says how many were lost.
+ */
+class PacketTrace
+{
+  public:
+    /// Record that event happened to p, event must be a string literal (we keep the pointer, not a copy)
+    void add(const char *event, const meshtastic_MeshPacket *p);
+
+    /// Log every event added since the last flush
+    void flush();
+
+    /// Number of events in the ring, index 0 is the oldest
+    size_t size();
+
+    /**
+     * Format the event at index as a line of text (without a newline)
+     *
+     * @return false if there is no such event
+     */
+    bool format(size_t index, char *buf, size_t bufLen);
+
+  private:
+    enum Flags : uint8_t { DECODED = 1, WANT_ACK = 2, WANT_RESPONSE = 4, VIA_MQTT = 8 };
+
+    struct Record {
+        uint32_t msec;     // millis() when the event happened
+        const char *event; // what happened
+        NodeNum from, to;
+        PacketId id;
+        float rxSnr;
+        uint16_t portnum; // only if flags has DECODED
+        uint8_t hopLimit, hopStart, channel, flags;
+    };
+
+    Record records[PACKET_TRACE_SIZE];
+    uint32_t numAdded = 0;   // total records ever added, the next one goes in records[numAdded % PACKET_TRACE_SIZE]
+    uint32_t numFlushed = 0; // total records ever flushed (or lost)
+    concurrency::Lock lock;  // we are called from the radio, router and phone API threads
+
+    static void formatRecord(const Record &r, char *buf, size_t bufLen);
+};
+
+extern PacketTrace packetTrace;
@@ -0,0 +1,37 @@
+#include "PayloadCache.h"
+#include "configuration.h"
+
+PayloadCache payloadCache;
+
+void PayloadCache::begin(const meshtastic_MeshPacket *p)
+{
+    packet = p;
+    cachedFields = NULL;
+}
+
+void PayloadCache::invalidate(const meshtastic_MeshPacket *p)
+{
+    if (p == packet)
+        cachedFields = NULL;
+}
+
+bool PayloadCache::decode(const meshtastic_MeshPacket &mp, const pb_msgdesc_t *fields, void *dest, size_t destSize)
+{
+    const meshtastic_Data &d = mp.decoded;
+    if (&mp != packet || destSize > sizeof(storage))
+        return pb_decode_from_bytes(d.payload.bytes, d.payload.size, fields, dest);
+
+    if (cachedFields == fields) {
+        numSaved++;
+        if (cachedOk)
+            memcpy(dest, &storage, destSize);
+        return cachedOk;
+    }
+
+    // Decode into dest (so it gets whatever the caller preset) and keep a copy for everyone after us
+    cachedOk = pb_decode_from_bytes(d.payload.bytes, d.payload.size, fields, dest);
+    cachedFields = fields;
+    if (cachedOk)
+        memcpy(&storage, dest, destSize);
+    return cachedOk;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "mesh/generated/meshtastic/mesh.pb.h"
+#include "mesh/generated/meshtastic/telemetry.pb.h"
+#include <pb.h>
+
+/**
+ * Remembers the last protobuf we decoded from the payload of the packet we are currently handling.
+ *
+ * Every ProtobufModule registered for a port (and later the MQTT JSON encoder) used to decode the same payload again for
+ * themselves.  While the router has the cache active for a packet, the first decode of each payload type is kept and the
+ * later ones are just a copy of it.
+ *
+ * The cache only holds decodes of packet p between begin(p) and end(), so a pool buffer reused for a different packet can
+ * never hit a stale entry.  Anything that changes the payload of the packet must call invalidate().
+ */
+class PayloadCache
+{
+  public:
+    /// Start caching decodes of p's payload
+    void begin(const meshtastic_MeshPacket *p);
+
+    /// Stop caching, the packet is done with
+    void end() { begin(NULL); }
+
+    /// The payload of p was changed, forget anything we decoded from it
+    void invalidate(const meshtastic_MeshPacket *p);
+
+    /**
+     * Decode the payload of mp as fields into dest (which should already be zeroed), reusing an earlier decode of the same
+     * payload if we have one
+     *
+     * @return false if the payload isn't a valid protobuf of that type
+     */
+    bool decode(const meshtastic_MeshPacket &mp, const pb_msgdesc_t *fields, void *dest, size_t destSize);
+
+    /// Number of decodes we saved by copying a cached one
+    uint32_t getNumSaved() const { return numSaved; }
+
+  private:
+    /// The payload types that are handled by more than one consumer, anything bigger than all of them isn't cached
+    union Storage {
+        meshtastic_Position position;
+        meshtastic_User user;
+        meshtastic_Telemetry telemetry;
+        meshtastic_NeighborInfo neighborInfo;
+        meshtastic_RouteDiscovery routeDiscovery;
+        meshtastic_Routing routing;
+    };
+
+    const meshtastic_MeshPacket *packet = NULL; // the packet we are caching for, or NULL
+    const pb_msgdesc_t *cachedFields = NULL;    // what storage holds, or NULL if nothing
+    bool cachedOk = false;                      // whether that decode succeeded
+    Storage storage;
+
+    uint32_t numSaved = 0;
+};
+
+extern PayloadCache payloadCache;
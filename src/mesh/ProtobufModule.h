@@ -1,4 +1,5 @@
 #pragma once
+#include "PayloadCache.h"
 #include "SinglePortModule.h"
 
 /**
@@ -32,6 +33,8 @@ template <class T> class ProtobufModule : protected SinglePortModule
     virtual bool handleReceivedProtobuf(const meshtastic_MeshPacket &mp, T *decoded) = 0;
 
     /** Called to make changes to a particular incoming message
+     *
+     * If you reencode the payload call payloadCache.invalidate(&mp), so nobody after you reuses the old decode.
      */
     virtual void alterReceivedProtobuf(meshtastic_MeshPacket &mp, T *decoded){};
 
@@ -88,7 +91,7 @@ template <class T> class ProtobufModule : protected SinglePortModule
         T *decoded = NULL;
         if (mp.which_payload_variant == meshtastic_MeshPacket_decoded_tag && mp.decoded.portnum == ourPortNum) {
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(p.payload.bytes, p.payload.size, fields, &scratch)) {
+            if (payloadCache.decode(mp, fields, &scratch, sizeof(scratch))) {
                 decoded = &scratch;
             } else {
                 LOG_ERROR("Error decoding protobuf module!\n");
@@ -108,8 +111,7 @@ template <class T> class ProtobufModule : protected SinglePortModule
         T *decoded = NULL;
         if (mp.which_payload_variant == meshtastic_MeshPacket_decoded_tag && mp.decoded.portnum == ourPortNum) {
             memset(&scratch, 0, sizeof(scratch));
-            auto &p = mp.decoded;
-            if (pb_decode_from_bytes(p.payload.bytes, p.payload.size, fields, &scratch)) {
+            if (payloadCache.decode(mp, fields, &scratch, sizeof(scratch))) {
                 decoded = &scratch;
             } else {
                 LOG_ERROR("Error decoding protobuf module!\n");
@@ -117,7 +119,7 @@ template <class T> class ProtobufModule : protected SinglePortModule
                 return;
             }
 
-            return alterReceivedProtobuf(mp, decoded);
+            alterReceivedProtobuf(mp, decoded);
         }
     }
 };
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "MeshRadio.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "PacketTrace.h"
 #include "Router.h"
 #include "configuration.h"
 #include "main.h"
@@ -149,8 +150,6 @@ const RegionInfo regions[] = {
 const RegionInfo *myRegion;
 bool RadioInterface::uses_default_frequency_slot = true;
 
-static uint8_t bytes[MAX_RHPACKETLEN];
-
 void initRegion()
 {
     const RegionInfo *r = regions;
@@ -187,7 +186,7 @@ separated by 2.16 MHz with respect to the adjacent channels. Channel zero starts
  *
  * @return num msecs for the packet
  */
-uint32_t RadioInterface::getPacketTime(uint32_t pl)
+uint32_t RadioInterface::calculatePacketTime(uint32_t pl) const
 {
     float bandwidthHz = bw * 1000.0f;
     bool headDisable = false; // we currently always use the header
@@ -202,29 +201,68 @@ uint32_t RadioInterface::getPacketTime(uint32_t pl)
     float tPacket = tPreamble + tPayload;
 
     uint32_t msecs = tPacket * 1000;
-
-    LOG_DEBUG("(bw=%d, sf=%d, cr=4/%d) packet symLen=%d ms, payloadSize=%u, time %d ms\n", (int)bw, sf, cr, (int)(tSym * 1000),
-              pl, msecs);
     return msecs;
 }
 
-uint32_t RadioInterface::getPacketTime(const meshtastic_MeshPacket *p)
+void RadioInterface::updatePacketTimes()
 {
-    uint32_t pl = 0;
-    if (p->which_payload_variant == meshtastic_MeshPacket_encrypted_tag) {
-        pl = p->encrypted.size + sizeof(PacketHeader);
-    } else {
-        size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
-        pl = numbytes + sizeof(PacketHeader);
+    if (bw == packetTimesBw && sf == packetTimesSf && cr == packetTimesCr && preambleLength == packetTimesPreamble)
+        return;
+
+    for (uint32_t pl = 0; pl < MAX_RHPACKETLEN; pl++)
+        packetTimes[pl] = calculatePacketTime(pl);
+
+    packetTimesBw = bw;
+    packetTimesSf = sf;
+    packetTimesCr = cr;
+    packetTimesPreamble = preambleLength;
+
+    LOG_DEBUG("(bw=%d, sf=%d, cr=4/%d, preamble=%u) packet time %u ms to %u ms\n", (int)bw, sf, cr, preambleLength,
+              packetTimes[0], packetTimes[MAX_RHPACKETLEN - 1]);
+}
+
+uint32_t RadioInterface::getPacketTime(uint32_t pl)
+{
+    if (pl >= MAX_RHPACKETLEN)
+        return calculatePacketTime(pl);
+
+    updatePacketTimes();
+    return packetTimes[pl];
+}
+
+uint32_t RadioInterface::getEncodedSize(const meshtastic_MeshPacket *p)
+{
+    if (p->which_payload_variant == meshtastic_MeshPacket_encrypted_tag)
+        return p->encrypted.size;
+
+    for (int i = 0; i < NUM_ENCODED_SIZES; i++) {
+        const EncodedSize &e = encodedSizes[i];
+        if (e.size && e.from == p->from && e.id == p->id && e.payloadSize == p->decoded.payload.size)
+            return e.size;
     }
-    return getPacketTime(pl);
+
+    // Encryption doesn't change the length, so sizing the Data protobuf (without encoding it anywhere) is enough
+    size_t size = 0;
+    pb_get_encoded_size(&size, &meshtastic_Data_msg, &p->decoded);
+
+    EncodedSize &e = encodedSizes[nextEncodedSize];
+    nextEncodedSize = (nextEncodedSize + 1) % NUM_ENCODED_SIZES;
+    e.from = p->from;
+    e.id = p->id;
+    e.payloadSize = p->decoded.payload.size;
+    e.size = size;
+    return size;
+}
+
+uint32_t RadioInterface::getPacketTime(const meshtastic_MeshPacket *p)
+{
+    return getPacketTime(getEncodedSize(p) + sizeof(PacketHeader));
 }
 
 /** The delay to use for retransmitting dropped packets */
 uint32_t RadioInterface::getRetransmissionMsec(const meshtastic_MeshPacket *p)
 {
-    size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
-    uint32_t packetAirtime = getPacketTime(numbytes + sizeof(PacketHeader));
+    uint32_t packetAirtime = getPacketTime(p);
     // Make sure enough time has elapsed for this packet to be sent and an ACK is received.
     // LOG_DEBUG("Waiting for flooding message with airtime %d and slotTime is %d\n", packetAirtime, slotTimeMsec);
     float channelUtil = airTime->channelUtilizationPercent();
@@ -237,94 +275,31 @@ uint32_t RadioInterface::getRetransmissionMsec(const meshtastic_MeshPacket *p)
 /** The delay to use when we want to send something */
 uint32_t RadioInterface::getTxDelayMsec()
 {
-    /** We wait a random multiple of 'slotTimes' (see definition in header file) in order to avoid collisions.
-    The pool to take a random multiple from is the contention window (CW), which size depends on the
-    current channel utilization. */
-    float channelUtil = airTime->channelUtilizationPercent();
-    uint8_t CWsize = map(channelUtil, 0, 100, CWmin, CWmax);
-    // LOG_DEBUG("Current channel utilization is %f so setting CWsize to %d\n", channelUtil, CWsize);
-    return random(0, pow(2, CWsize)) * slotTimeMsec;
+    return txScheduler->getTxDelayMsec(slotTimeMsec);
 }
 
 /** The delay to use when we want to flood a message */
 uint32_t RadioInterface::getTxDelayMsecWeighted(float snr)
 {
-    // The minimum value for a LoRa SNR
-    const uint32_t SNR_MIN = -20;
-
-    // The maximum value for a LoRa SNR
-    const uint32_t SNR_MAX = 15;
-
-    //  high SNR = large CW size (Long Delay)
-    //  low SNR = small CW size (Short Delay)
-    uint32_t delay = 0;
-    uint8_t CWsize = map(snr, SNR_MIN, SNR_MAX, CWmin, CWmax);
-    // LOG_DEBUG("rx_snr of %f so setting CWsize to:%d\n", snr, CWsize);
-    if (config.device.role == meshtastic_Config_DeviceConfig_Role_ROUTER ||
-        config.device.role == meshtastic_Config_DeviceConfig_Role_REPEATER) {
-        delay = random(0, 2 * CWsize) * slotTimeMsec;
-        LOG_DEBUG("rx_snr found in packet. As a router, setting tx delay:%d\n", delay);
-    } else {
-        // offset the maximum delay for routers: (2 * CWmax * slotTimeMsec)
-        delay = (2 * CWmax * slotTimeMsec) + random(0, pow(2, CWsize)) * slotTimeMsec;
-        LOG_DEBUG("rx_snr found in packet. Setting tx delay:%d\n", delay);
-    }
+    return txScheduler->getTxDelayMsecWeighted(snr, slotTimeMsec);
+}
 
-    return delay;
+void RadioInterface::setTxScheduler(TxScheduler *scheduler)
+{
+    delete txScheduler;
+    txScheduler = scheduler;
 }
 
 void printPacket(const char *prefix, const meshtastic_MeshPacket *p)
 {
-#ifdef DEBUG_PORT
-    std::string out = DEBUG_PORT.mt_sprintf("%s (id=0x%08x fr=0x%02x to=0x%02x, WantAck=%d, HopLim=%d Ch=0x%x", prefix, p->id,
-                                            p->from & 0xff, p->to & 0xff, p->want_ack, p->hop_limit, p->channel);
-    if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
-        auto &s = p->decoded;
-
-        out += DEBUG_PORT.mt_sprintf(" Portnum=%d", s.portnum);
-
-        if (s.want_response)
-            out += DEBUG_PORT.mt_sprintf(" WANTRESP");
-
-        if (s.source != 0)
-            out += DEBUG_PORT.mt_sprintf(" source=%08x", s.source);
-
-        if (s.dest != 0)
-            out += DEBUG_PORT.mt_sprintf(" dest=%08x", s.dest);
-
-        if (s.request_id)
-            out += DEBUG_PORT.mt_sprintf(" requestId=%0x", s.request_id);
-
-        /* now inside Data and therefore kinda opaque
-        if (s.which_ackVariant == SubPacket_success_id_tag)
-            out += DEBUG_PORT.mt_sprintf(" successId=%08x", s.ackVariant.success_id);
-        else if (s.which_ackVariant == SubPacket_fail_id_tag)
-            out += DEBUG_PORT.mt_sprintf(" failId=%08x", s.ackVariant.fail_id); */
-    } else {
-        out += " encrypted";
-    }
-
-    if (p->rx_time != 0)
-        out += DEBUG_PORT.mt_sprintf(" rxtime=%u", p->rx_time);
-    if (p->rx_snr != 0.0)
-        out += DEBUG_PORT.mt_sprintf(" rxSNR=%g", p->rx_snr);
-    if (p->rx_rssi != 0)
-        out += DEBUG_PORT.mt_sprintf(" rxRSSI=%i", p->rx_rssi);
-    if (p->via_mqtt != 0)
-        out += DEBUG_PORT.mt_sprintf(" via MQTT");
-    if (p->hop_start != 0)
-        out += DEBUG_PORT.mt_sprintf(" hopStart=%d", p->hop_start);
-    if (p->priority != 0)
-        out += DEBUG_PORT.mt_sprintf(" priority=%d", p->priority);
-
-    out += ")";
-    LOG_DEBUG("%s\n", out.c_str());
-#endif
+    packetTrace.add(prefix, p);
 }
 
 RadioInterface::RadioInterface()
 {
     assert(sizeof(PacketHeader) == 16); // make sure the compiler did what we expected
+
+    txScheduler = new AdaptiveTxScheduler(CWmin, CWmax);
 }
 
 bool RadioInterface::reconfigure()
@@ -515,6 +490,7 @@ void RadioInterface::applyModemConfig()
     saveChannelNum(channel_num);
     saveFreq(freq + loraConfig.frequency_offset);
 
+    updatePacketTimes();
     preambleTimeMsec = getPacketTime((uint32_t)0);
     maxPacketTimeMsec = getPacketTime(meshtastic_Constants_DATA_PAYLOAD_LEN + sizeof(PacketHeader));
 
@@ -550,8 +526,10 @@ void RadioInterface::limitPower()
 
 void RadioInterface::deliverToReceiver(meshtastic_MeshPacket *p)
 {
-    if (router)
+    if (router) {
+        routerStats.mark(p, RouterStats::STAGE_RX_DONE);
         router->enqueueReceivedMessage(p);
+    }
 }
 
 /***
@@ -4,6 +4,7 @@
 #include "MeshTypes.h"
 #include "Observer.h"
 #include "PointerQueue.h"
+#include "TxScheduler.h"
 #include "airtime.h"
 
 #define MAX_TX_QUEUE 16 // max number of packets which can be waiting for transmission
@@ -80,6 +81,8 @@ class RadioInterface
     const uint8_t CWmin = 2; // minimum CWsize
     const uint8_t CWmax = 8; // maximum CWsize
 
+    TxScheduler *txScheduler = NULL; // picks our transmit delays, owned by us
+
     meshtastic_MeshPacket *sendingPacket = NULL; // The packet we are currently sending
     uint32_t lastTxStart = 0L;
 
@@ -88,17 +91,40 @@ class RadioInterface
      * */
     uint8_t radiobuf[MAX_RHPACKETLEN];
 
+    /// Airtime (in msecs) of a packet of each total length, for the modem settings we built it with (see updatePacketTimes())
+    uint32_t packetTimes[MAX_RHPACKETLEN];
+    float packetTimesBw = 0;
+    uint8_t packetTimesSf = 0, packetTimesCr = 0;
+    uint16_t packetTimesPreamble = 0;
+
+    /// The encoded lengths of the last few decoded packets we were asked about, retransmissions ask about the same ones again
+    struct EncodedSize {
+        NodeNum from;
+        PacketId id;
+        pb_size_t payloadSize;
+        uint16_t size; // 0 if this slot is unused
+    };
+    static const int NUM_ENCODED_SIZES = 4;
+    EncodedSize encodedSizes[NUM_ENCODED_SIZES] = {};
+    uint8_t nextEncodedSize = 0;
+
     /**
      * Enqueue a received packet for the registered receiver
      */
     void deliverToReceiver(meshtastic_MeshPacket *p);
 
+    /// Rebuild packetTimes if bw, sf, cr or preambleLength changed since we last built it
+    void updatePacketTimes();
+
+    /// @return the length of p's payload once encoded (and encrypted), without the PacketHeader
+    uint32_t getEncodedSize(const meshtastic_MeshPacket *p);
+
   public:
     /** pool is the pool we will alloc our rx packets from
      */
     RadioInterface();
 
-    virtual ~RadioInterface() {}
+    virtual ~RadioInterface() { delete txScheduler; }
 
     /**
      * Return true if we think the board can go to sleep (i.e. our tx queue is empty, we are not sending or receiving)
@@ -158,6 +184,12 @@ class RadioInterface
     /** The delay to use when we want to flood a message. Use a weighted scale based on SNR */
     uint32_t getTxDelayMsecWeighted(float snr);
 
+    /// The policy we pick transmit delays with, tell it about anything it should know of the channel
+    TxScheduler *getTxScheduler() { return txScheduler; }
+
+    /// Replace our transmit delay policy (we take ownership of scheduler)
+    void setTxScheduler(TxScheduler *scheduler);
+
     /**
      * Calculate airtime per
      * https://www.rs-online.com/designspark/rel-assets/ds-assets/uploads/knowledge-items/application-notes-for-the-internet-of-things/LoRa%20Design%20Guide.pdf
@@ -168,6 +200,9 @@ class RadioInterface
     uint32_t getPacketTime(const meshtastic_MeshPacket *p);
     uint32_t getPacketTime(uint32_t totalPacketLen);
 
+    /// Airtime per the formula above, getPacketTime() looks this up in a table instead of calculating it every time
+    uint32_t calculatePacketTime(uint32_t totalPacketLen) const;
+
     /**
      * Get the channel we saved.
      */
@@ -234,5 +269,6 @@ class RadioInterface
     }
 };
 
-/// Debug printing for packets
+/// Debug printing for packets, this only records the event in packetTrace (prefix must be a string literal), it is logged
+/// later when the main loop flushes the trace
 void printPacket(const char *prefix, const meshtastic_MeshPacket *p);
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "MeshTypes.h"
 #include "NodeDB.h"
 #include "PowerMon.h"
+#include "RouterStats.h"
 #include "SPILock.h"
 #include "configuration.h"
 #include "error.h"
@@ -165,6 +166,7 @@ ErrorCode RadioLibInterface::send(meshtastic_MeshPacket *p)
 
     LOG_DEBUG("txGood=%d,rxGood=%d,rxBad=%d\n", txGood, rxGood, rxBad);
     ErrorCode res = txQueue.enqueue(p) ? ERRNO_OK : ERRNO_UNKNOWN;
+    updateTxQueueDepth();
 
     if (res != ERRNO_OK) { // we weren't able to queue it, so we must drop it to prevent leaks
         packetPool.release(p);
@@ -203,12 +205,18 @@ bool RadioLibInterface::canSleep()
     return res;
 }
 
+void RadioLibInterface::updateTxQueueDepth()
+{
+    routerStats.setTxQueueDepth(txQueue.getMaxLen() - txQueue.getFree());
+}
+
 /** Attempt to cancel a previously sent packet.  Returns true if a packet was found we could cancel */
 bool RadioLibInterface::cancelSending(NodeNum from, PacketId id)
 {
     auto p = txQueue.remove(from, id);
     if (p)
         packetPool.release(p); // free the packet we just removed
+    updateTxQueueDepth();
 
     bool result = (p != NULL);
     LOG_DEBUG("cancelSending id=0x%x, removed=%d\n", id, result);
@@ -247,7 +255,9 @@ void RadioLibInterface::onNotify(uint32_t notification)
                 // LOG_DEBUG("Currently Rx/Tx-ing: set random delay\n");
                 setTransmitDelay(); // currently Rx/Tx-ing: reset random delay
             } else {
-                if (isChannelActive()) { // check if there is currently a LoRa packet on the channel
+                bool channelActive = isChannelActive(); // check if there is currently a LoRa packet on the channel
+                txScheduler->onChannelChecked(channelActive);
+                if (channelActive) {
                     // LOG_DEBUG("Channel is active, try receiving first.\n");
                     startReceive(); // try receiving this packet, afterwards we'll be trying to transmit again
                     setTransmitDelay();
@@ -255,11 +265,13 @@ void RadioLibInterface::onNotify(uint32_t notification)
                     // Send any outgoing packets we have ready
                     meshtastic_MeshPacket *txp = txQueue.dequeue();
                     assert(txp);
+                    updateTxQueueDepth();
                     startSend(txp);
 
                     // Packet has been sent, count it toward our TX airtime utilization.
                     uint32_t xmitMsec = getPacketTime(txp);
                     airTime->logAirtime(TX_LOG, xmitMsec);
+                    txScheduler->onTransmit(txp);
                 }
             }
         } else {
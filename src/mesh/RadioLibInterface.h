@@ -68,6 +68,9 @@ class RadioLibInterface : public RadioInterface, protected concurrency::Notified
 
     MeshPacketQueue txQueue = MeshPacketQueue(MAX_TX_QUEUE);
 
+    /// Tell routerStats how deep txQueue is, after anything that changes it
+    void updateTxQueueDepth();
+
   protected:
     /**
      * We use a meshtastic sync word, but hashed with the Channel name.  For releases before 1.2 we used 0x12 (or for very old
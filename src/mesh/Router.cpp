@@ -2,7 +2,9 @@
 #include "Channels.h"
 #include "CryptoEngine.h"
 #include "MeshRadio.h"
+#include "MeshService.h"
 #include "NodeDB.h"
+#include "PayloadCache.h"
 #include "RTC.h"
 #include "configuration.h"
 #include "main.h"
@@ -23,18 +25,35 @@
 #define MAX_RX_FROMRADIO                                                                                                         \
     4 // max number of packets destined to our queue, we dispatch packets quickly so it doesn't need to be big
 
+/// The most received packets runOnce() handles in one go (holding back NodeDB, power and phone notifications until the end)
+#ifndef ROUTER_RX_BATCH_SIZE
+#define ROUTER_RX_BATCH_SIZE 8
+#endif
+
 // I think this is right, one packet for each of the three fifos + one packet being currently assembled for TX or RX
 // And every TX packet might have a retransmission packet or an ack alive at any moment
 #define MAX_PACKETS                                                                                                              \
     (MAX_RX_TOPHONE + MAX_RX_FROMRADIO + 2 * MAX_TX_QUEUE +                                                                      \
      2) // max number of packets which can be in flight (either queued from reception or queued for sending)
 
-// static MemoryPool<MeshPacket> staticPool(MAX_PACKETS);
+/// Set MESHTASTIC_PACKET_POOL=0 in build_flags to go back to plain malloc/free for every packet
+#ifndef MESHTASTIC_PACKET_POOL
+#if defined(ARCH_ESP32) || defined(ARCH_NRF52)
+#define MESHTASTIC_PACKET_POOL 1
+#else
+#define MESHTASTIC_PACKET_POOL 0
+#endif
+#endif
+
+#if MESHTASTIC_PACKET_POOL
+static MemoryPool<meshtastic_MeshPacket> staticPool(MAX_PACKETS);
+#else
 static MemoryDynamic<meshtastic_MeshPacket> staticPool;
+#endif
 
 Allocator<meshtastic_MeshPacket> &packetPool = staticPool;
 
-static uint8_t bytes[MAX_RHPACKETLEN];
+uint32_t numRejectedTrialDecrypts, numWastedTrialDecrypts;
 
 /**
  * Constructor
@@ -50,8 +69,11 @@ Router::Router() : concurrency::OSThread("Router"), fromRadioQueue(MAX_RX_FROMRA
     LOG_DEBUG("Size of MeshPacket %d\n", sizeof(MeshPacket)); */
 
     fromRadioQueue.setReader(this);
+#if MESHTASTIC_PACKET_POOL
+    routerStats.setPacketPool(&staticPool);
+#endif
 
-    // init Lockguard for crypt operations
+    // init Lockguard for crypt operations (only used by crypto engines that can't work from a per call CryptoContext)
     assert(!cryptLock);
     cryptLock = new concurrency::Lock();
 }
@@ -63,10 +85,25 @@ Router::Router() : concurrency::OSThread("Router"), fromRadioQueue(MAX_RX_FROMRA
 int32_t Router::runOnce()
 {
     meshtastic_MeshPacket *mp;
-    while ((mp = fromRadioQueue.dequeuePtr(0)) != NULL) {
+    int numHandled = 0;
+    while (numHandled < ROUTER_RX_BATCH_SIZE && (mp = fromRadioQueue.dequeuePtr(0)) != NULL) {
+        if (numHandled++ == 0)
+            service.beginRxBatch();
+
         // printPacket("handle fromRadioQ", mp);
+        routerStats.mark(mp, RouterStats::STAGE_DEQUEUED);
         perhapsHandleReceived(mp);
     }
+    if (numHandled)
+        service.endRxBatch();
+    routerStats.setFromRadioDepth(fromRadioQueue.numUsed());
+
+#ifdef ARCH_PORTDUINO
+    routerStats.logIfDue();
+#endif
+
+    if (!fromRadioQueue.isEmpty())
+        return 0; // more packets waiting, let the other threads have a turn before we handle the next batch
 
     // LOG_DEBUG("sleeping forever!\n");
     return INT32_MAX; // Wait a long time - until we get woken for the message queue
@@ -78,12 +115,15 @@ int32_t Router::runOnce()
  */
 void Router::enqueueReceivedMessage(meshtastic_MeshPacket *p)
 {
+    routerStats.mark(p, RouterStats::STAGE_ENQUEUED);
     if (fromRadioQueue.enqueue(p, 0)) { // NOWAIT - fixme, if queue is full, delete older messages
+        routerStats.setFromRadioDepth(fromRadioQueue.numUsed());
 
         // Nasty hack because our threading is primitive.  interfaces shouldn't need to know about routers FIXME
         setReceivedMessage();
     } else {
         printPacket("BUG! fromRadioQueue is full! Discarding!", p);
+        routerStats.finish(p);
         packetPool.release(p);
     }
 }
@@ -252,21 +292,27 @@ ErrorCode Router::send(meshtastic_MeshPacket *p)
     // If the packet is not yet encrypted, do so now
     if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
         ChannelIndex chIndex = p->channel; // keep as a local because we are about to change it
-        meshtastic_MeshPacket *p_decoded = packetPool.allocCopy(*p);
+
+        // Only keep a decoded copy if MQTT is going to publish it, we're the original transmitter of the packet
+        meshtastic_MeshPacket *p_decoded = NULL;
+#if !MESHTASTIC_EXCLUDE_MQTT
+        if (moduleConfig.mqtt.enabled && p->from == nodeDB->getNodeNum() && mqtt)
+            p_decoded = packetPool.allocCopy(*p);
+#endif
 
         auto encodeResult = perhapsEncode(p);
         if (encodeResult != meshtastic_Routing_Error_NONE) {
-            packetPool.release(p_decoded);
+            if (p_decoded)
+                packetPool.release(p_decoded);
             abortSendAndNak(encodeResult, p);
             return encodeResult; // FIXME - this isn't a valid ErrorCode
         }
 #if !MESHTASTIC_EXCLUDE_MQTT
-        // Only publish to MQTT if we're the original transmitter of the packet
-        if (moduleConfig.mqtt.enabled && p->from == nodeDB->getNodeNum() && mqtt) {
+        if (p_decoded) {
             mqtt->onSend(*p, *p_decoded, chIndex);
+            packetPool.release(p_decoded);
         }
 #endif
-        packetPool.release(p_decoded);
     }
 
     assert(iface); // This should have been detected already in sendLocal (or we just received a packet from outside)
@@ -288,10 +334,18 @@ void Router::sniffReceived(const meshtastic_MeshPacket *p, const meshtastic_Rout
     // FIXME, update nodedb here for any packet that passes through us
 }
 
-bool perhapsDecode(meshtastic_MeshPacket *p)
+/**
+ * A cheap sanity check on the start of a decrypted payload, so we only pay for the full decrypt and protobuf decode when the
+ * key looks right.  Encoders write fields in field number order, so a valid Data always starts with the (nonzero) portnum
+ * varint: tag 0x08 followed by a nonzero byte.  A wrong key only gets past this about once in 256 tries.
+ */
+static bool isPlausibleData(const uint8_t *plaintext, size_t numBytes)
 {
-    concurrency::LockGuard g(cryptLock);
+    return numBytes >= 2 && plaintext[0] == ((meshtastic_Data_portnum_tag << 3) | PB_WT_VARINT) && plaintext[1] != 0;
+}
 
+bool perhapsDecode(meshtastic_MeshPacket *p)
+{
     if (config.device.role == meshtastic_Config_DeviceConfig_Role_REPEATER &&
         config.device.rebroadcast_mode == meshtastic_Config_DeviceConfig_RebroadcastMode_ALL_SKIP_DECODING)
         return false;
@@ -307,19 +361,37 @@ bool perhapsDecode(meshtastic_MeshPacket *p)
 
     // assert(p->which_payloadVariant == MeshPacket_encrypted_tag);
 
+    // All of our crypto state lives on this stack frame, so several threads can decode at once without a global lock
+    CryptoContext ctx;
+    uint8_t bytes[MAX_RHPACKETLEN];
+
     // Try to find a channel that works with this hash
     for (ChannelIndex chIndex = 0; chIndex < channels.getNumChannels(); chIndex++) {
         // Try to use this hash/channel pair
         if (channels.decryptForHash(chIndex, p->channel)) {
+            PreparedKeyRef keyRef(channels.acquirePreparedKey(chIndex));
+            const CryptoEngine::PreparedKey *key = keyRef.get();
+            if (!key)
+                continue;
+
             // Try to decrypt the packet if we can
             size_t rawSize = p->encrypted.size;
             if (rawSize > sizeof(bytes)) {
                 LOG_ERROR("Packet too large to attempt decription! (rawSize=%d > 256)\n", rawSize);
                 return false;
             }
-            memcpy(bytes, p->encrypted.bytes,
-                   rawSize); // we have to copy into a scratch buffer, because these bytes are a union with the decoded protobuf
-            crypto->decrypt(p->from, p->id, rawSize, bytes);
+
+            // Decrypt just the first block to see if this key is even plausible, CTR mode lets us do that cheaply
+            uint8_t head[16];
+            size_t headSize = min(rawSize, sizeof(head));
+            crypto->decrypt(ctx, *key, p->from, p->id, headSize, p->encrypted.bytes, head);
+            if (!isPlausibleData(head, headSize)) {
+                numRejectedTrialDecrypts++;
+                continue;
+            }
+
+            // we have to decrypt into a scratch buffer, because these bytes are a union with the decoded protobuf
+            crypto->decrypt(ctx, *key, p->from, p->id, rawSize, p->encrypted.bytes, bytes);
 
             // printBytes("plaintext", bytes, p->encrypted.size);
 
@@ -327,8 +399,10 @@ bool perhapsDecode(meshtastic_MeshPacket *p)
             memset(&p->decoded, 0, sizeof(p->decoded));
             if (!pb_decode_from_bytes(bytes, rawSize, &meshtastic_Data_msg, &p->decoded)) {
                 LOG_ERROR("Invalid protobufs in received mesh packet (bad psk?)!\n");
+                numWastedTrialDecrypts++;
             } else if (p->decoded.portnum == meshtastic_PortNum_UNKNOWN_APP) {
                 LOG_ERROR("Invalid portnum (bad psk?)!\n");
+                numWastedTrialDecrypts++;
             } else {
                 // parsing was successful
                 p->which_payload_variant = meshtastic_MeshPacket_decoded_tag; // change type to decoded
@@ -368,10 +442,9 @@ bool perhapsDecode(meshtastic_MeshPacket *p)
  */
 meshtastic_Routing_Error perhapsEncode(meshtastic_MeshPacket *p)
 {
-    concurrency::LockGuard g(cryptLock);
-
     // If the packet is not yet encrypted, do so now
     if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
+        uint8_t bytes[MAX_RHPACKETLEN];
         size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
 
         /* Not actually used, so save the cycles
@@ -417,16 +490,18 @@ meshtastic_Routing_Error perhapsEncode(meshtastic_MeshPacket *p)
 
         ChannelIndex chIndex = p->channel; // keep as a local because we are about to change it
         auto hash = channels.setActiveByIndex(chIndex);
-        if (hash < 0)
+        PreparedKeyRef keyRef(channels.acquirePreparedKey(chIndex));
+        const CryptoEngine::PreparedKey *key = keyRef.get();
+        if (hash < 0 || !key)
             // No suitable channel could be found for sending
             return meshtastic_Routing_Error_NO_CHANNEL;
 
         // Now that we are encrypting the packet channel should be the hash (no longer the index)
         p->channel = hash;
-        crypto->encrypt(getFrom(p), p->id, numbytes, bytes);
 
-        // Copy back into the packet and set the variant type
-        memcpy(p->encrypted.bytes, bytes, numbytes);
+        // Encrypt straight back into the packet and set the variant type
+        CryptoContext ctx;
+        crypto->encrypt(ctx, *key, getFrom(p), p->id, numbytes, bytes, p->encrypted.bytes);
         p->encrypted.size = numbytes;
         p->which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
     }
@@ -448,11 +523,18 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
     bool skipHandle = false;
     // Also, we should set the time from the ISR and it should have msec level resolution
     p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
-    // Store a copy of encrypted packet for MQTT
-    meshtastic_MeshPacket *p_encrypted = packetPool.allocCopy(*p);
+
+    // Store a copy of encrypted packet for MQTT, but only if MQTT is actually going to publish the encrypted form
+    meshtastic_MeshPacket *p_encrypted = NULL;
+#if !MESHTASTIC_EXCLUDE_MQTT
+    bool mqttWantsPacket = moduleConfig.mqtt.enabled && mqtt && !p->via_mqtt && getFrom(p) != nodeDB->getNodeNum();
+    if (mqttWantsPacket && moduleConfig.mqtt.encryption_enabled)
+        p_encrypted = packetPool.allocCopy(*p);
+#endif
 
     // Take those raw bytes and convert them back into a well structured protobuf we can understand
     bool decoded = perhapsDecode(p);
+    routerStats.mark(p, RouterStats::STAGE_DECODED);
     if (decoded) {
         // parsing was successful, queue for our recipient
         if (src == RX_SRC_LOCAL)
@@ -474,18 +556,23 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
         printPacket("packet decoding failed or skipped (no PSK?)", p);
     }
 
-    // call modules here
+    // call modules here, they (and MQTT) all share one decode of each payload type
     if (!skipHandle) {
+        payloadCache.begin(p);
         MeshModule::callModules(*p, src);
+        routerStats.mark(p, RouterStats::STAGE_MODULES_DONE);
 
 #if !MESHTASTIC_EXCLUDE_MQTT
         // After potentially altering it, publish received message to MQTT if we're not the original transmitter of the packet
-        if (decoded && moduleConfig.mqtt.enabled && getFrom(p) != nodeDB->getNodeNum() && mqtt)
-            mqtt->onSend(*p_encrypted, *p, p->channel);
+        // (without encryption MQTT only looks at the decoded packet, so it can have that for both)
+        if (decoded && mqttWantsPacket)
+            mqtt->onSend(p_encrypted ? *p_encrypted : *p, *p, p->channel);
 #endif
+        payloadCache.end();
     }
 
-    packetPool.release(p_encrypted); // Release the encrypted packet
+    if (p_encrypted)
+        packetPool.release(p_encrypted); // Release the encrypted packet
 }
 
 void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
@@ -504,5 +591,6 @@ void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
     if (!ignore)
         handleReceived(p);
 
+    routerStats.finish(p);
     packetPool.release(p);
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "Observer.h"
 #include "PointerQueue.h"
 #include "RadioInterface.h"
+#include "RouterStats.h"
 #include "concurrency/OSThread.h"
 
 /**
@@ -139,6 +140,12 @@ class Router : protected concurrency::OSThread
  */
 bool perhapsDecode(meshtastic_MeshPacket *p);
 
+/// How many channel trials in perhapsDecode were rejected after decrypting just the first block
+extern uint32_t numRejectedTrialDecrypts;
+
+/// How many channel trials in perhapsDecode paid for a full decrypt and decode but still turned out to be the wrong key
+extern uint32_t numWastedTrialDecrypts;
+
 /** Return 0 for success or a Routing_Errror code for failure
  */
 meshtastic_Routing_Error perhapsEncode(meshtastic_MeshPacket *p);
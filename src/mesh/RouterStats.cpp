@@ -0,0 +1,105 @@
+#include "RouterStats.h"
+#include "PacketHistory.h"
+#include "PayloadCache.h"
+#include "Router.h"
+#include "configuration.h"
+
+RouterStats routerStats;
+
+static_assert(ROUTER_STATS_NUM_BUCKETS == 16, "RouterStats::log() needs updating");
+
+static const char *stageNames[RouterStats::NUM_STAGES] = {"rx_done", "enqueued", "dequeued", "decoded", "rebroadcast_queued",
+                                                          "modules_done"};
+
+const char *RouterStats::getStageName(Stage stage)
+{
+    return stageNames[stage];
+}
+
+RouterStats::Trace *RouterStats::findTrace(const meshtastic_MeshPacket *p)
+{
+    for (int i = 0; i < ROUTER_STATS_MAX_TRACED; i++)
+        if (traces[i].p == p)
+            return &traces[i];
+    return NULL;
+}
+
+void RouterStats::mark(const meshtastic_MeshPacket *p, Stage stage)
+{
+    uint32_t now = micros();
+    if (now == 0)
+        now = 1; // 0 means not stamped
+
+    Trace *t = findTrace(p);
+    if (!t) {
+        // Only the first stages we see a packet at can start a trace, anything later is a packet we gave up on tracing
+        if (stage > STAGE_DEQUEUED)
+            return;
+
+        t = findTrace(NULL);
+        if (!t) {
+            numUntraced++;
+            return;
+        }
+        memset(t, 0, sizeof(*t));
+        t->p = p;
+    }
+    t->stamps[stage] = now;
+}
+
+void RouterStats::finish(const meshtastic_MeshPacket *p)
+{
+    Trace *t = findTrace(p);
+    if (!t)
+        return;
+
+    uint32_t prev = 0;
+    for (int stage = 0; stage < NUM_STAGES; stage++) {
+        uint32_t stamp = t->stamps[stage];
+        if (!stamp)
+            continue;
+
+        // A stage we stamped out of order would wrap around into the slowest bucket, leave it out
+        if (prev && (int32_t)(stamp - prev) < 0)
+            continue;
+
+        if (prev) {
+            uint32_t elapsed = stamp - prev;
+            int bucket = 0;
+            while (bucket < ROUTER_STATS_NUM_BUCKETS - 1 && elapsed >= getBucketStart(bucket + 1))
+                bucket++;
+            histograms[stage][bucket]++;
+        }
+        prev = stamp;
+    }
+    t->p = NULL;
+}
+
+void RouterStats::log()
+{
+    LOG_INFO("Router stats: fromRadioQueue depth=%u max=%u, txQueue depth=%u max=%u, untraced=%u, decodes saved=%u\n",
+             fromRadioDepth.current, fromRadioDepth.max, txQueueDepth.current, txQueueDepth.max, numUntraced,
+             payloadCache.getNumSaved());
+    LOG_INFO("  trial decrypts rejected=%u wasted=%u\n", numRejectedTrialDecrypts, numWastedTrialDecrypts);
+    if (pool)
+        LOG_INFO("  packet pool in use=%u max=%u of %u, exhausted=%u\n", pool->getNumInUse(), pool->getHighWaterMark(),
+                 pool->getMaxElements(), pool->getNumExhausted());
+    if (history)
+        LOG_INFO("  packet history hits=%u misses=%u evictions=%u\n", history->getNumHits(), history->getNumMisses(),
+                 history->getNumEvictions());
+
+    for (int stage = STAGE_ENQUEUED; stage < NUM_STAGES; stage++) {
+        const uint32_t *h = histograms[stage];
+        LOG_INFO("  %-18s %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u\n", stageNames[stage], h[0], h[1], h[2], h[3], h[4],
+                 h[5], h[6], h[7], h[8], h[9], h[10], h[11], h[12], h[13], h[14], h[15]);
+    }
+}
+
+void RouterStats::logIfDue()
+{
+    uint32_t now = millis();
+    if (now - lastLogMsec >= ROUTER_STATS_LOG_INTERVAL) {
+        lastLogMsec = now;
+        log();
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "MeshTypes.h"
+
+class PacketHistory;
+
+/// How many packets we can be timing at once, packets beyond this just aren't traced
+#define ROUTER_STATS_MAX_TRACED 8
+
+/// Number of buckets in each latency histogram (log() prints exactly this many)
+#define ROUTER_STATS_NUM_BUCKETS 16
+
+/// How often (in msecs) to log a summary, if enabled for this platform
+#define ROUTER_STATS_LOG_INTERVAL (5 * 60 * 1000UL)
+
+/**
+ * Lightweight instrumentation of our receive pipeline, so we can see where the time goes on a busy router.
+ *
+ * Each received packet is stamped (with micros()) as it reaches each stage.  When it is done with, the time it spent
+ * getting to every stage from the stage before is added to a per stage histogram.  Histogram bucket 0 counts everything
+ * under 32 usec, bucket n counts [2^(n+4), 2^(n+5)) usec and the last bucket is everything slower.
+ *
+ * We also keep gauges of how deep our receive and transmit queues get, and report the usage of the packet pool and
+ * the packet history.
+ */
+class RouterStats
+{
+  public:
+    /// In the order they happen, each one is timed from the latest earlier stage the packet was stamped at
+    enum Stage {
+        STAGE_RX_DONE = 0,        // the radio finished receiving the packet
+        STAGE_ENQUEUED,           // Router::enqueueReceivedMessage put it in fromRadioQueue
+        STAGE_DEQUEUED,           // the router thread took it off fromRadioQueue
+        STAGE_DECODED,            // perhapsDecode finished (successfully or not)
+        STAGE_REBROADCAST_QUEUED, // FloodingRouter queued our rebroadcast of it (from the RoutingModule, so during callModules)
+        STAGE_MODULES_DONE        // MeshModule::callModules returned
+    };
+    static const int NUM_STAGES = STAGE_MODULES_DONE + 1;
+
+    struct Gauge {
+        uint16_t current, max;
+    };
+
+    /// Note that packet p has reached stage (packets are told apart by address, so only while they are in our care)
+    void mark(const meshtastic_MeshPacket *p, Stage stage);
+
+    /// We are done with packet p, add its timings to our histograms
+    void finish(const meshtastic_MeshPacket *p);
+
+    void setFromRadioDepth(uint16_t depth) { setGauge(fromRadioDepth, depth); }
+    void setTxQueueDepth(uint16_t depth) { setGauge(txQueueDepth, depth); }
+
+    /// Histogram of the time it took packets to get to stage from the previous stage they were stamped at
+    const uint32_t *getHistogram(Stage stage) const { return histograms[stage]; }
+
+    /// @return the smallest number of usecs that lands in histogram bucket
+    static uint32_t getBucketStart(int bucket) { return bucket == 0 ? 0 : 1UL << (bucket + 4); }
+
+    static const char *getStageName(Stage stage);
+
+    const Gauge &getFromRadioDepth() const { return fromRadioDepth; }
+    const Gauge &getTxQueueDepth() const { return txQueueDepth; }
+
+    /// Number of packets we couldn't trace because too many were in flight
+    uint32_t getNumUntraced() const { return numUntraced; }
+
+    /// The pool packets are allocated from, if this build uses one
+    void setPacketPool(const MemoryPool<meshtastic_MeshPacket> *p) { pool = p; }
+    const MemoryPool<meshtastic_MeshPacket> *getPacketPool() const { return pool; }
+
+    /// The record of packets we have seen, if our router keeps one
+    void setPacketHistory(const PacketHistory *h) { history = h; }
+    const PacketHistory *getPacketHistory() const { return history; }
+
+    /// Log our histograms and gauges
+    void log();
+
+    /// Log our histograms and gauges if it has been ROUTER_STATS_LOG_INTERVAL since we last did
+    void logIfDue();
+
+  private:
+    struct Trace {
+        const meshtastic_MeshPacket *p; // NULL if this slot is free
+        uint32_t stamps[NUM_STAGES];    // micros() at each stage or 0 if we never saw it reach that stage
+    };
+
+    Trace traces[ROUTER_STATS_MAX_TRACED] = {};
+    uint32_t histograms[NUM_STAGES][ROUTER_STATS_NUM_BUCKETS] = {};
+    Gauge fromRadioDepth = {}, txQueueDepth = {};
+    uint32_t numUntraced = 0;
+    uint32_t lastLogMsec = 0;
+    const MemoryPool<meshtastic_MeshPacket> *pool = NULL;
+    const PacketHistory *history = NULL;
+
+    Trace *findTrace(const meshtastic_MeshPacket *p);
+
+    static void setGauge(Gauge &g, uint16_t depth)
+    {
+        g.current = depth;
+        if (depth > g.max)
+            g.max = depth;
+    }
+};
+
+extern RouterStats routerStats;
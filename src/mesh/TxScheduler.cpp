@@ -0,0 +1,129 @@
+#include "TxScheduler.h"
+#include "NodeDB.h"
+#include "airtime.h"
+#include "configuration.h"
+
+uint32_t TxScheduler::getTxDelayMsec(uint32_t slotTimeMsec)
+{
+    /** We wait a random multiple of 'slotTimes' (see definition in RadioInterface.h) in order to avoid collisions.
+    The pool to take a random multiple from is the contention window (CW), which size depends on the
+    current channel utilization. */
+    float channelUtil = airTime->channelUtilizationPercent();
+    uint8_t CWsize = adjustCWSize(map(channelUtil, 0, 100, CWmin, CWmax));
+    // LOG_DEBUG("Current channel utilization is %f so setting CWsize to %d\n", channelUtil, CWsize);
+    return random(0, pow(2, CWsize)) * slotTimeMsec;
+}
+
+uint32_t TxScheduler::getTxDelayMsecWeighted(float snr, uint32_t slotTimeMsec)
+{
+    // The minimum value for a LoRa SNR
+    const uint32_t SNR_MIN = -20;
+
+    // The maximum value for a LoRa SNR
+    const uint32_t SNR_MAX = 15;
+
+    //  high SNR = large CW size (Long Delay)
+    //  low SNR = small CW size (Short Delay)
+    uint32_t delay = 0;
+    uint8_t CWsize = adjustCWSize(map(snr, SNR_MIN, SNR_MAX, CWmin, CWmax));
+    // LOG_DEBUG("rx_snr of %f so setting CWsize to:%d\n", snr, CWsize);
+    if (config.device.role == meshtastic_Config_DeviceConfig_Role_ROUTER ||
+        config.device.role == meshtastic_Config_DeviceConfig_Role_REPEATER) {
+        delay = random(0, 2 * CWsize) * slotTimeMsec;
+        LOG_DEBUG("rx_snr found in packet. As a router, setting tx delay:%d\n", delay);
+    } else {
+        // offset the maximum delay for routers: (2 * CWmax * slotTimeMsec)
+        delay = (2 * CWmax * slotTimeMsec) + random(0, pow(2, CWsize)) * slotTimeMsec;
+        LOG_DEBUG("rx_snr found in packet. Setting tx delay:%d\n", delay);
+    }
+
+    return delay;
+}
+
+void AdaptiveTxScheduler::onChannelChecked(bool busy)
+{
+    perhapsEndWindow();
+    window.numChecks++;
+    if (busy)
+        window.numBusy++;
+}
+
+void AdaptiveTxScheduler::onTransmit(const meshtastic_MeshPacket *p)
+{
+    perhapsEndWindow();
+    if (getFrom(p) == nodeDB->getNodeNum())
+        return; // Copies of our own packets are the flood working, not redundant rebroadcasts
+
+    Rebroadcast &r = window.rebroadcasts[window.numRebroadcast % TX_SCHEDULER_REBROADCAST_HISTORY];
+    r.from = getFrom(p);
+    r.id = p->id;
+    window.numRebroadcast++;
+}
+
+void AdaptiveTxScheduler::onDuplicateHeard(const meshtastic_MeshPacket *p, bool cancelled)
+{
+    perhapsEndWindow();
+    if (cancelled)
+        window.numCancelled++;
+    else if (wasRebroadcast(p))
+        window.numDuplicates++;
+}
+
+bool AdaptiveTxScheduler::wasRebroadcast(const meshtastic_MeshPacket *p) const
+{
+    NodeNum from = getFrom(p);
+    uint16_t n = window.numRebroadcast;
+    if (n > TX_SCHEDULER_REBROADCAST_HISTORY)
+        n = TX_SCHEDULER_REBROADCAST_HISTORY;
+    for (uint16_t i = 0; i < n; i++)
+        if (window.rebroadcasts[i].from == from && window.rebroadcasts[i].id == p->id)
+            return true;
+    return false;
+}
+
+uint8_t AdaptiveTxScheduler::adjustCWSize(uint8_t CWsize)
+{
+    perhapsEndWindow();
+    int adjusted = CWsize + bias;
+    return adjusted < CWmin ? CWmin : (adjusted > CWmax ? CWmax : adjusted);
+}
+
+void AdaptiveTxScheduler::perhapsEndWindow()
+{
+    uint32_t now = millis();
+    if (now - windowStart < TX_SCHEDULER_WINDOW_MSEC)
+        return;
+
+    const Window &w = window;
+    int8_t oldBias = bias;
+    if (w.numChecks + w.numDuplicates + w.numCancelled < TX_SCHEDULER_MIN_SAMPLES) {
+        // Not enough traffic to tell, drift back to the classic policy
+        if (bias > 0)
+            bias--;
+        else if (bias < 0)
+            bias++;
+    } else {
+        // Compare as integers: busy rate >= 1/4 is crowded, <= 1/16 is quiet.  Without any channel checks (we had nothing to
+        // send, or all of it was cancelled) we can't tell either way, and leave it to the duplicate counts
+        bool crowded = w.numChecks && w.numBusy * 4 >= w.numChecks;
+        bool quiet = !w.numChecks || w.numBusy * 16 <= w.numChecks;
+
+        // Every rebroadcast heard more than twice after we had already sent ours means too many of us picked the same slots
+        bool redundant = w.numDuplicates > 2 * w.numRebroadcast;
+
+        // Cancellations are airtime the wider window saved us, only shrink if it isn't earning its keep
+        bool sparse = w.numDuplicates + w.numCancelled <= w.numRebroadcast;
+
+        if ((crowded || redundant) && bias < TX_SCHEDULER_MAX_BIAS)
+            bias++;
+        else if (quiet && sparse && bias > -TX_SCHEDULER_MAX_BIAS)
+            bias--;
+    }
+
+    if (bias != oldBias)
+        LOG_INFO("TX scheduler: CW bias %d -> %d (checks=%u busy=%u rebroadcast=%u duplicates=%u cancelled=%u)\n", oldBias, bias,
+                 w.numChecks, w.numBusy, w.numRebroadcast, w.numDuplicates, w.numCancelled);
+
+    window = {};
+    windowStart = now;
+}
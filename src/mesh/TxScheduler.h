@@ -0,0 +1,121 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include <stdint.h>
+
+/// Length (in msecs) of the window the adaptive scheduler collects channel statistics over before adjusting its CW
+#ifndef TX_SCHEDULER_WINDOW_MSEC
+#define TX_SCHEDULER_WINDOW_MSEC (60 * 1000UL)
+#endif
+
+/// The fewest events (channel checks + duplicates heard) a window needs before we trust it enough to adjust the CW
+#ifndef TX_SCHEDULER_MIN_SAMPLES
+#define TX_SCHEDULER_MIN_SAMPLES 8
+#endif
+
+/// The most the adaptive scheduler may move the CW size away from what the channel utilization/SNR mapping picked
+#ifndef TX_SCHEDULER_MAX_BIAS
+#define TX_SCHEDULER_MAX_BIAS 3
+#endif
+
+/// How many of the packets we rebroadcast in a window we remember, to recognise later copies of them
+#ifndef TX_SCHEDULER_REBROADCAST_HISTORY
+#define TX_SCHEDULER_REBROADCAST_HISTORY 16
+#endif
+
+/**
+ * Picks the random delay (a whole number of slot times, taken from a contention window) we wait before each transmit.
+ *
+ * This base class is the classic policy: the CW size of packets we originate scales with channel utilization, the CW size
+ * of packets we flood scales with the SNR we heard them at (so the nodes furthest away rebroadcast first), and routers
+ * flood before everyone else.
+ *
+ * RadioInterface asks its scheduler for every delay, and tells it what happened on the channel, so subclasses can tune
+ * the CW size to what they observe.
+ */
+class TxScheduler
+{
+  public:
+    TxScheduler(uint8_t cwMin, uint8_t cwMax) : CWmin(cwMin), CWmax(cwMax) {}
+    virtual ~TxScheduler() {}
+
+    /** The delay to use when we want to send something */
+    uint32_t getTxDelayMsec(uint32_t slotTimeMsec);
+
+    /** The delay to use when we want to flood a message. Use a weighted scale based on SNR */
+    uint32_t getTxDelayMsecWeighted(float snr, uint32_t slotTimeMsec);
+
+    /// Our delay ran out and we checked the channel (CAD) before sending, busy if someone else was transmitting
+    virtual void onChannelChecked(bool busy) {}
+
+    /// We started transmitting p
+    virtual void onTransmit(const meshtastic_MeshPacket *p) {}
+
+    /// We heard p, a flooded packet we had already seen, cancelled is true if that let us drop our own pending rebroadcast of it
+    virtual void onDuplicateHeard(const meshtastic_MeshPacket *p, bool cancelled) {}
+
+  protected:
+    const uint8_t CWmin; // minimum CWsize
+    const uint8_t CWmax; // maximum CWsize
+
+    /// @return the CW size to really use, given the one the channel utilization/SNR mapping picked
+    virtual uint8_t adjustCWSize(uint8_t CWsize) { return CWsize; }
+};
+
+/**
+ * A TxScheduler that widens or narrows the contention window based on live channel statistics, aiming for the most
+ * delivered packets per second of airtime.
+ *
+ * Over each TX_SCHEDULER_WINDOW_MSEC we count:
+ *  - how often the channel was busy when our delay ran out (collisions we only just avoided, and the ones we didn't
+ *    avoid grow with it)
+ *  - how many duplicates of flooded packets we heard after we had already rebroadcast them in this window (airtime we
+ *    spent on a copy someone nearby had covered anyway).  Copies of packets we never rebroadcast, or whose rebroadcast
+ *    was cancelled or is still waiting, say nothing about our window and aren't counted
+ *  - how many of our pending rebroadcasts were cancelled because someone else's copy beat us (airtime saved)
+ *
+ * A busy channel or a lot of redundant rebroadcasts means our window is too small for the number of nodes contending,
+ * so we grow it.  A quiet channel with few redundant copies means we are only adding latency, so we shrink it back.
+ * Each window moves the CW size by at most one, and never further than TX_SCHEDULER_MAX_BIAS from the classic policy, so
+ * with no evidence this behaves exactly like TxScheduler.
+ */
+class AdaptiveTxScheduler : public TxScheduler
+{
+  public:
+    AdaptiveTxScheduler(uint8_t cwMin, uint8_t cwMax) : TxScheduler(cwMin, cwMax) {}
+
+    virtual void onChannelChecked(bool busy) override;
+    virtual void onTransmit(const meshtastic_MeshPacket *p) override;
+    virtual void onDuplicateHeard(const meshtastic_MeshPacket *p, bool cancelled) override;
+
+    /// How far (in CW sizes) we currently are from the classic policy
+    int8_t getBias() const { return bias; }
+
+  protected:
+    virtual uint8_t adjustCWSize(uint8_t CWsize) override;
+
+  private:
+    struct Rebroadcast {
+        NodeNum from;
+        PacketId id;
+    };
+
+    struct Window {
+        uint16_t numChecks;      // CAD checks before a transmit
+        uint16_t numBusy;        // of which found the channel busy
+        uint16_t numRebroadcast; // packets of other nodes we transmitted
+        uint16_t numDuplicates;  // duplicates heard of those, after we had sent them
+        uint16_t numCancelled;   // duplicates heard that cancelled our pending rebroadcast
+        Rebroadcast rebroadcasts[TX_SCHEDULER_REBROADCAST_HISTORY]; // the latest of them, oldest overwritten first
+    };
+
+    Window window = {};
+    uint32_t windowStart = 0;
+    int8_t bias = 0;
+
+    /// @return true if p is one of the packets we rebroadcast in this window
+    bool wasRebroadcast(const meshtastic_MeshPacket *p) const;
+
+    /// If the current window is over, adjust bias from what we saw in it and start the next one
+    void perhapsEndWindow();
+};
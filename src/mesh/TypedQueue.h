@@ -33,13 +33,23 @@ template <class T> class TypedQueue
      * they want */
     bool enqueue(T x, TickType_t maxWait)
     {
-        if (reader) {
-            reader->setInterval(0);
-            concurrency::mainDelay.interrupt();
-        }
+        wakeReader();
         return xQueueSendToBack(h, &x, maxWait) == pdTRUE;
     }
 
+    /**
+     * enqueue x without waiting, first dequeuing (and passing to onDropped) as many of the oldest elements as it takes to make
+     * room
+     */
+    template <typename F> void enqueueDropOldest(T x, F onDropped)
+    {
+        wakeReader();
+        T old;
+        while (xQueueSendToBack(h, &x, 0) != pdTRUE)
+            if (xQueueReceive(h, &old, 0) == pdTRUE)
+                onDropped(old);
+    }
+
     bool enqueueFromISR(T x, BaseType_t *higherPriWoken)
     {
         if (reader) {
@@ -60,56 +70,212 @@ template <class T> class TypedQueue
      * Note: thread will not be automatically enabled, just have its interval set to 0
      */
     void setReader(concurrency::OSThread *t) { reader = t; }
+
+  private:
+    void wakeReader()
+    {
+        if (reader) {
+            reader->setInterval(0);
+            concurrency::mainDelay.interrupt();
+        }
+    }
 };
 
 #else
 
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 
 /**
- * A wrapper for freertos queues.  Note: each element object should be small
- * and POD (Plain Old Data type) as elements are memcpied by value.
+ * A bounded queue for platforms without freertos (i.e. portduino, where the web server and API have threads of their own).
+ * Note: each element object should be small and POD (Plain Old Data type) as elements are copied by value.
+ *
+ * The elements live in a ring of maxElements cells.  Each cell has a sequence number saying which position in the queue
+ * it may next be written (or read) at, so any number of threads can enqueue and dequeue without taking a lock (this is
+ * D. Vyukov's bounded MPMC queue).  The mutex is only used to sleep on by callers that asked to wait for room or for an
+ * element.
  */
 template <class T> class TypedQueue
 {
-    std::queue<T> q;
+    static_assert(std::is_pod<T>::value, "T must be pod");
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    const size_t maxElements;
+    Cell *cells;
+    std::atomic<size_t> head{0}, tail{0}; // the positions we will next dequeue from and enqueue to
     concurrency::OSThread *reader = NULL;
 
+    std::mutex waitLock;
+    std::condition_variable changed;
+    std::atomic<int> numWaiting{0};
+
   public:
-    explicit TypedQueue(int maxElements) {}
+    explicit TypedQueue(int _maxElements) : maxElements(_maxElements), cells(new Cell[_maxElements])
+    {
+        assert(_maxElements > 0);
+        for (size_t i = 0; i < maxElements; i++)
+            cells[i].sequence = i;
+    }
+
+    ~TypedQueue() { delete[] cells; }
 
-    int numFree() { return 1; } // Always claim 1 free, because we can grow to any size
+    int numFree() { return maxElements - numUsed(); }
 
-    bool isEmpty() { return q.empty(); }
+    bool isEmpty() { return numUsed() == 0; }
 
-    int numUsed() { return q.size(); }
+    int numUsed()
+    {
+        size_t h = head;
+        size_t used = tail - h; // tail only grows, so reading it second can't give us less than 0
+        return used > maxElements ? maxElements : used;
+    }
 
+    /** enqueue an element, waiting up to maxWait msecs for room if the queue is full (portMAX_DELAY waits forever)
+     * @return false if there still wasn't room */
     bool enqueue(T x, TickType_t maxWait = portMAX_DELAY)
+    {
+        wakeReader();
+        if (!retry([&]() { return tryEnqueue(x); }, maxWait))
+            return false;
+        notifyWaiters();
+        return true;
+    }
+
+    /**
+     * enqueue x without waiting, first dequeuing (and passing to onDropped) as many of the oldest elements as it takes to make
+     * room
+     */
+    template <typename F> void enqueueDropOldest(T x, F onDropped)
+    {
+        wakeReader();
+        T old;
+        while (!tryEnqueue(x))
+            if (tryDequeue(&old))
+                onDropped(old);
+        notifyWaiters();
+    }
+
+    /// We have no real ISRs, this is just a non blocking enqueue for code shared with freertos builds
+    bool enqueueFromISR(T x, BaseType_t *higherPriWoken)
+    {
+        *higherPriWoken = false;
+        return enqueue(x, 0);
+    }
+
+    /** dequeue the oldest element, waiting up to maxWait msecs for one if the queue is empty (portMAX_DELAY waits forever)
+     * @return false if the queue was still empty */
+    bool dequeue(T *p, TickType_t maxWait = portMAX_DELAY)
+    {
+        if (!retry([&]() { return tryDequeue(p); }, maxWait))
+            return false;
+        notifyWaiters();
+        return true;
+    }
+
+    bool dequeueFromISR(T *p, BaseType_t *higherPriWoken)
+    {
+        *higherPriWoken = false;
+        return dequeue(p, 0);
+    }
+
+    /**
+     * Set a thread that is reading from this queue
+     * If a message is pushed to this queue that thread will be scheduled to run ASAP.
+     *
+     * Note: thread will not be automatically enabled, just have its interval set to 0
+     */
+    void setReader(concurrency::OSThread *t) { reader = t; }
+
+  private:
+    void wakeReader()
     {
         if (reader) {
             reader->setInterval(0);
             concurrency::mainDelay.interrupt();
         }
+    }
 
-        q.push(x);
-        return true;
+    bool tryEnqueue(const T &x)
+    {
+        size_t pos = tail;
+        for (;;) {
+            Cell &c = cells[pos % maxElements];
+            size_t seq = c.sequence;
+            if (seq == pos) {
+                // The cell is free for this position, claim it (or see who beat us to it)
+                if (tail.compare_exchange_weak(pos, pos + 1)) {
+                    c.data = x;
+                    c.sequence = pos + 1;
+                    return true;
+                }
+            } else if ((ptrdiff_t)(seq - pos) < 0)
+                return false; // the cell still holds the element from a lap ago, so we are full
+            else
+                pos = tail; // someone else enqueued at pos, try again at the new tail
+        }
     }
 
-    // bool enqueueFromISR(T x, BaseType_t *higherPriWoken) { return xQueueSendToBackFromISR(h, &x, higherPriWoken) == pdTRUE; }
+    bool tryDequeue(T *p)
+    {
+        size_t pos = head;
+        for (;;) {
+            Cell &c = cells[pos % maxElements];
+            size_t seq = c.sequence;
+            if (seq == pos + 1) {
+                if (head.compare_exchange_weak(pos, pos + 1)) {
+                    *p = c.data;
+                    c.sequence = pos + maxElements; // free for the enqueue one lap from now
+                    return true;
+                }
+            } else if ((ptrdiff_t)(seq - (pos + 1)) < 0)
+                return false; // nothing has been written at pos yet, so we are empty
+            else
+                pos = head;
+        }
+    }
 
-    bool dequeue(T *p, TickType_t maxWait = portMAX_DELAY)
+    /// We changed the queue, wake anyone waiting in retry() (cheaply if no one is).  Must not be called with waitLock held.
+    void notifyWaiters()
     {
-        if (isEmpty())
-            return false;
-        else {
-            *p = q.front();
-            q.pop();
-            return true;
+        if (numWaiting) {
+            std::lock_guard<std::mutex> guard(waitLock);
+            changed.notify_all();
         }
     }
 
-    // bool dequeueFromISR(T *p, BaseType_t *higherPriWoken) { return xQueueReceiveFromISR(h, p, higherPriWoken); }
+    /**
+     * Call attempt() until it succeeds or maxWait msecs pass, sleeping in between until the queue changes.
+     *
+     * Waiters count themselves before their final attempt and notifiers change the queue before checking the count (all
+     * seq_cst), so a change can't slip in between a failed attempt and the wait without a notify.
+     */
+    template <typename F> bool retry(F attempt, TickType_t maxWait)
+    {
+        if (attempt())
+            return true;
+        if (maxWait == 0)
+            return false;
 
-    void setReader(concurrency::OSThread *t) { reader = t; }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(maxWait);
+        std::unique_lock<std::mutex> guard(waitLock);
+        numWaiting++;
+        bool ok;
+        while (!(ok = attempt())) {
+            if (maxWait == portMAX_DELAY)
+                changed.wait(guard);
+            else if (changed.wait_until(guard, deadline) == std::cv_status::timeout) {
+                ok = attempt();
+                break;
+            }
+        }
+        numWaiting--;
+        return ok;
+    }
 };
 #endif
@@ -1,7 +1,11 @@
 #if !MESHTASTIC_EXCLUDE_WEBSERVER
 #include "NodeDB.h"
+#include "PacketHistory.h"
 #include "PowerFSM.h"
+#include "PayloadCache.h"
 #include "RadioLibInterface.h"
+#include "Router.h"
+#include "RouterStats.h"
 #include "airtime.h"
 #include "main.h"
 #include "mesh/http/ContentHelper.h"
@@ -652,6 +656,43 @@ void handleReport(HTTPRequest *req, HTTPResponse *res)
     jsonObjRadio["frequency"] = new JSONValue(RadioLibInterface::instance->getFreq());
     jsonObjRadio["lora_channel"] = new JSONValue((int)RadioLibInterface::instance->getChannelNum() + 1);
 
+    // data->router
+    JSONObject jsonObjRouter;
+    for (int stage = RouterStats::STAGE_ENQUEUED; stage < RouterStats::NUM_STAGES; stage++) {
+        JSONArray histogramValues;
+        const uint32_t *histogram = routerStats.getHistogram((RouterStats::Stage)stage);
+        for (int i = 0; i < ROUTER_STATS_NUM_BUCKETS; i++) {
+            histogramValues.push_back(new JSONValue((int)histogram[i]));
+        }
+        jsonObjRouter[RouterStats::getStageName((RouterStats::Stage)stage)] = new JSONValue(histogramValues);
+    }
+    JSONArray bucketStartValues;
+    for (int i = 0; i < ROUTER_STATS_NUM_BUCKETS; i++) {
+        bucketStartValues.push_back(new JSONValue((int)RouterStats::getBucketStart(i)));
+    }
+    jsonObjRouter["bucket_start_usec"] = new JSONValue(bucketStartValues);
+    jsonObjRouter["from_radio_depth"] = new JSONValue((int)routerStats.getFromRadioDepth().current);
+    jsonObjRouter["from_radio_depth_max"] = new JSONValue((int)routerStats.getFromRadioDepth().max);
+    jsonObjRouter["tx_queue_depth"] = new JSONValue((int)routerStats.getTxQueueDepth().current);
+    jsonObjRouter["tx_queue_depth_max"] = new JSONValue((int)routerStats.getTxQueueDepth().max);
+    jsonObjRouter["untraced"] = new JSONValue((int)routerStats.getNumUntraced());
+    jsonObjRouter["decodes_saved"] = new JSONValue((int)payloadCache.getNumSaved());
+    jsonObjRouter["trial_decrypts_rejected"] = new JSONValue((int)numRejectedTrialDecrypts);
+    jsonObjRouter["trial_decrypts_wasted"] = new JSONValue((int)numWastedTrialDecrypts);
+    const MemoryPool<meshtastic_MeshPacket> *pool = routerStats.getPacketPool();
+    if (pool) {
+        jsonObjRouter["packet_pool_size"] = new JSONValue((int)pool->getMaxElements());
+        jsonObjRouter["packet_pool_in_use"] = new JSONValue((int)pool->getNumInUse());
+        jsonObjRouter["packet_pool_in_use_max"] = new JSONValue((int)pool->getHighWaterMark());
+        jsonObjRouter["packet_pool_exhausted"] = new JSONValue((int)pool->getNumExhausted());
+    }
+    const PacketHistory *history = routerStats.getPacketHistory();
+    if (history) {
+        jsonObjRouter["history_hits"] = new JSONValue((int)history->getNumHits());
+        jsonObjRouter["history_misses"] = new JSONValue((int)history->getNumMisses());
+        jsonObjRouter["history_evictions"] = new JSONValue((int)history->getNumEvictions());
+    }
+
     // collect data to inner data object
     JSONObject jsonObjInner;
     jsonObjInner["airtime"] = new JSONValue(jsonObjAirtime);
@@ -660,6 +701,7 @@ void handleReport(HTTPRequest *req, HTTPResponse *res)
     jsonObjInner["power"] = new JSONValue(jsonObjPower);
     jsonObjInner["device"] = new JSONValue(jsonObjDevice);
     jsonObjInner["radio"] = new JSONValue(jsonObjRadio);
+    jsonObjInner["router"] = new JSONValue(jsonObjRouter);
 
     // create json output structure
     JSONObject jsonObjOuter;
@@ -205,18 +205,12 @@ bool AdminModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp, meshta
     }
     case meshtastic_AdminMessage_set_favorite_node_tag: {
         LOG_INFO("Client is receiving a set_favorite_node command.\n");
-        meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(r->set_favorite_node);
-        if (node != NULL) {
-            node->is_favorite = true;
-        }
+        nodeDB->setFavorite(r->set_favorite_node, true);
         break;
     }
     case meshtastic_AdminMessage_remove_favorite_node_tag: {
         LOG_INFO("Client is receiving a remove_favorite_node command.\n");
-        meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(r->remove_favorite_node);
-        if (node != NULL) {
-            node->is_favorite = false;
-        }
+        nodeDB->setFavorite(r->remove_favorite_node, false);
         break;
     }
     case meshtastic_AdminMessage_set_fixed_position_tag: {
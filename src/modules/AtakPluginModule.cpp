@@ -98,6 +98,7 @@ void AtakPluginModule::alterReceivedProtobuf(meshtastic_MeshPacket &mp, meshtast
         }
         mp.decoded.payload.size = pb_encode_to_bytes(mp.decoded.payload.bytes, sizeof(mp.decoded.payload.bytes),
                                                      meshtastic_TAKPacket_fields, &compressed);
+        payloadCache.invalidate(&mp);
         LOG_DEBUG("Final payload: %d bytes\n", mp.decoded.payload.size);
     } else {
         if (!t->is_compressed) {
@@ -88,6 +88,9 @@ class CannedMessageModule : public SinglePortModule, public Observable<const UIF
         }
     }
 
+    /// wantPacket() watches the signal of every packet, so we must be asked about all of them
+    virtual meshtastic_PortNum getDispatchPortNum() override { return meshtastic_PortNum_UNKNOWN_APP; }
+
   protected:
     virtual int32_t runOnce() override;
 
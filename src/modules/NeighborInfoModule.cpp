@@ -151,6 +151,7 @@ void NeighborInfoModule::alterReceivedProtobuf(meshtastic_MeshPacket &p, meshtas
     // Set updated last_sent_by_id to the payload of the to be flooded packet
     p.decoded.payload.size =
         pb_encode_to_bytes(p.decoded.payload.bytes, sizeof(p.decoded.payload.bytes), &meshtastic_NeighborInfo_msg, n);
+    payloadCache.invalidate(&p);
 }
 
 void NeighborInfoModule::resetNeighbors()
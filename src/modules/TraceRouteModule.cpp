@@ -29,6 +29,7 @@ void TraceRouteModule::alterReceivedProtobuf(meshtastic_MeshPacket &p, meshtasti
         // Set updated route to the payload of the to be flooded packet
         p.decoded.payload.size =
             pb_encode_to_bytes(p.decoded.payload.bytes, sizeof(p.decoded.payload.bytes), &meshtastic_RouteDiscovery_msg, r);
+        payloadCache.invalidate(&p);
     }
 }
 
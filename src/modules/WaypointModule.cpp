@@ -135,8 +135,9 @@ void WaypointModule::drawFrame(OLEDDisplay *display, OLEDDisplayUiState *state,
             myHeading = screen->estimatedHeading(DegD(op.latitude_i), DegD(op.longitude_i));
         screen->drawCompassNorth(display, compassX, compassY, myHeading);
 
-        // Distance to Waypoint
-        float d = GeoCoord::latLongToMeter(DegD(wp.latitude_i), DegD(wp.longitude_i), DegD(op.latitude_i), DegD(op.longitude_i));
+        // Distance and compass bearing to waypoint
+        float d, bearingToOther;
+        GeoOrigin(op.latitude_i, op.longitude_i).distanceAndBearingTo(wp.latitude_i, wp.longitude_i, d, bearingToOther);
         if (config.display.units == meshtastic_Config_DisplayConfig_DisplayUnits_IMPERIAL) {
             if (d < (2 * MILES_TO_FEET))
                 snprintf(distStr, sizeof(distStr), "%.0f ft", d * METERS_TO_FEET);
@@ -149,9 +150,6 @@ void WaypointModule::drawFrame(OLEDDisplay *display, OLEDDisplayUiState *state,
                 snprintf(distStr, sizeof(distStr), "%.1f km", d / 1000);
         }
 
-        // Compass bearing to waypoint
-        float bearingToOther =
-            GeoCoord::bearing(DegD(op.latitude_i), DegD(op.longitude_i), DegD(wp.latitude_i), DegD(wp.longitude_i));
         // If the top of the compass is a static north then bearingToOther can be drawn on the compass directly
         // If the top of the compass is not a static north we need adjust bearingToOther based on heading
         if (!config.display.compass_north_top)
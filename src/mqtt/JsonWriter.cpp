@@ -0,0 +1,150 @@
+#include "JsonWriter.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+JsonWriter::JsonWriter(char *_buf, size_t _size) : buf(_buf), size(_size)
+{
+    if (size)
+        buf[0] = '\0';
+    else
+        overflow = true;
+}
+
+void JsonWriter::put(char c)
+{
+    put(&c, 1);
+}
+
+void JsonWriter::put(const char *s, size_t n)
+{
+    if (overflow || len + n >= size) {
+        overflow = true;
+        return;
+    }
+    memcpy(buf + len, s, n);
+    len += n;
+    buf[len] = '\0';
+}
+
+/// Escape the way JSONValue::StringifyString() does, except bytes >= 0x80 (i.e. UTF-8) are passed through unmangled
+void JsonWriter::putString(const char *s, size_t n)
+{
+    put('"');
+    for (size_t i = 0; i < n; i++) {
+        char c = s[i];
+        switch (c) {
+        case '"':
+        case '\\':
+        case '/': {
+            char esc[2] = {'\\', c};
+            put(esc, 2);
+            break;
+        }
+        case '\b':
+            put("\\b", 2);
+            break;
+        case '\f':
+            put("\\f", 2);
+            break;
+        case '\n':
+            put("\\n", 2);
+            break;
+        case '\r':
+            put("\\r", 2);
+            break;
+        case '\t':
+            put("\\t", 2);
+            break;
+        default:
+            if ((uint8_t)c < ' ' || (uint8_t)c == 0x7f) {
+                char esc[7];
+                snprintf(esc, sizeof(esc), "\\u%04X", (uint8_t)c);
+                put(esc, 6);
+            } else {
+                put(c);
+            }
+        }
+    }
+    put('"');
+}
+
+void JsonWriter::beginValue(const char *key)
+{
+    if (!first)
+        put(',');
+    first = false;
+    if (key) {
+        putString(key, strlen(key));
+        put(':');
+    }
+}
+
+void JsonWriter::beginObject(const char *key)
+{
+    beginValue(key);
+    put('{');
+    first = true;
+}
+
+void JsonWriter::endObject()
+{
+    put('}');
+    first = false;
+}
+
+void JsonWriter::beginArray(const char *key)
+{
+    beginValue(key);
+    put('[');
+    first = true;
+}
+
+void JsonWriter::endArray()
+{
+    put(']');
+    first = false;
+}
+
+void JsonWriter::add(const char *key, const char *value)
+{
+    add(key, value, strlen(value));
+}
+
+void JsonWriter::add(const char *key, const char *value, size_t n)
+{
+    beginValue(key);
+    putString(value, n);
+}
+
+void JsonWriter::add(const char *key, int value)
+{
+    char num[12];
+    beginValue(key);
+    put(num, snprintf(num, sizeof(num), "%d", value));
+}
+
+void JsonWriter::add(const char *key, unsigned int value)
+{
+    char num[12];
+    beginValue(key);
+    put(num, snprintf(num, sizeof(num), "%u", value));
+}
+
+void JsonWriter::add(const char *key, double value)
+{
+    beginValue(key);
+    if (isinf(value) || isnan(value)) {
+        put("null", 4);
+    } else {
+        // Same as the stringstream with precision(15) that JSONValue uses
+        char num[32];
+        put(num, snprintf(num, sizeof(num), "%.15g", value));
+    }
+}
+
+void JsonWriter::addRaw(const char *key, const char *json)
+{
+    beginValue(key);
+    put(json, strlen(json));
+}
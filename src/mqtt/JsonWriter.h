@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Writes compact JSON straight into a caller supplied buffer, without building a tree of JSONValues first.
+ *
+ * Values are written in the order they are added, so to produce the same text as JSONValue::Stringify() (whose objects are
+ * std::maps) callers must add object members in sorted key order.  Numbers and strings are formatted the way Stringify()
+ * does it.
+ *
+ * If the buffer fills up everything after that is dropped and overflowed() returns true, the buffer always stays nul
+ * terminated.
+ */
+class JsonWriter
+{
+  public:
+    JsonWriter(char *buf, size_t size);
+
+    /// Start an object, as a member of the enclosing object (key != NULL) or an element of the enclosing array (key == NULL)
+    void beginObject(const char *key = NULL);
+    void endObject();
+
+    void beginArray(const char *key = NULL);
+    void endArray();
+
+    void add(const char *key, const char *value);
+    void add(const char *key, const char *value, size_t len);
+    void add(const char *key, int value);
+    void add(const char *key, unsigned int value);
+    void add(const char *key, double value);
+
+    /// Add some already encoded JSON as a value
+    void addRaw(const char *key, const char *json);
+
+    const char *c_str() const { return buf; }
+    size_t length() const { return len; }
+
+    /// @return true if the buffer was too small for everything we were asked to write
+    bool overflowed() const { return overflow; }
+
+  private:
+    char *buf;
+    size_t size, len = 0;
+    bool first = true; // nothing has been written in the innermost object/array yet
+    bool overflow = false;
+
+    void put(char c);
+    void put(const char *s, size_t n);
+    void putString(const char *s, size_t n);
+
+    /// Write the separator (if needed) and key for the next value
+    void beginValue(const char *key);
+};
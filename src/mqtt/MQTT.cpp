@@ -1,6 +1,7 @@
 #include "MQTT.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "PayloadCache.h"
 #include "PowerFSM.h"
 #include "configuration.h"
 #include "main.h"
@@ -9,6 +10,7 @@
 #include "mesh/generated/meshtastic/mqtt.pb.h"
 #include "mesh/generated/meshtastic/telemetry.pb.h"
 #include "modules/RoutingModule.h"
+#include "mqtt/JsonWriter.h"
 #if defined(ARCH_ESP32)
 #include "../mesh/generated/meshtastic/paxcount.pb.h"
 #endif
@@ -176,9 +178,9 @@ void mqttInit()
 }
 
 #if HAS_NETWORKING
-MQTT::MQTT() : concurrency::OSThread("mqtt"), pubSub(mqttClient), mqttQueue(MAX_MQTT_QUEUE)
+MQTT::MQTT() : concurrency::OSThread("mqtt"), pubSub(mqttClient)
 #else
-MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE)
+MQTT::MQTT() : concurrency::OSThread("mqtt")
 #endif
 {
     if (moduleConfig.mqtt.enabled) {
@@ -206,6 +208,8 @@ MQTT::MQTT() : concurrency::OSThread("mqtt"), mqttQueue(MAX_MQTT_QUEUE)
                 moduleConfig.mqtt.map_report_settings.publish_interval_secs, default_map_publish_interval_secs);
         }
 
+        spool.begin();
+
 #if HAS_NETWORKING
         if (!moduleConfig.mqtt.proxy_to_client_enabled)
             pubSub.setCallback(mqttCallback);
@@ -430,6 +434,8 @@ int32_t MQTT::runOnce()
             pubSub.disconnect();
         }
 
+        publishQueuedMessages();
+
         powerFSM.trigger(EVENT_CONTACT_FROM_PHONE); // Suppress entering light sleep (because that would turn off bluetooth)
         return 20;
     }
@@ -447,32 +453,20 @@ void MQTT::publishStatus()
 
 void MQTT::publishQueuedMessages()
 {
-    if (!mqttQueue.isEmpty()) {
-        LOG_DEBUG("Publishing enqueued MQTT message\n");
-        // FIXME - this size calculation is super sloppy, but it will go away once we dynamically alloc meshpackets
-        meshtastic_ServiceEnvelope *env = mqttQueue.dequeuePtr(0);
-        static uint8_t bytes[meshtastic_MeshPacket_size + 64];
-        size_t numBytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_ServiceEnvelope_msg, env);
-
-        std::string topic = cryptTopic + env->channel_id + "/" + owner.id;
-        LOG_INFO("publish %s, %u bytes from queue\n", topic.c_str(), numBytes);
-
-        publish(topic.c_str(), bytes, numBytes, false);
+    if (spool.isEmpty() || millis() - lastSpoolDrain < MQTT_SPOOL_DRAIN_INTERVAL)
+        return;
+    lastSpoolDrain = millis();
 
-#ifndef ARCH_NRF52 // JSON is not supported on nRF52, see issue #2804
-        if (moduleConfig.mqtt.json_enabled) {
-            // handle json topic
-            auto jsonString = this->meshPacketToJson(env->packet);
-            if (jsonString.length() != 0) {
-                std::string topicJson = jsonTopic + env->channel_id + "/" + owner.id;
-                LOG_INFO("JSON publish message to %s, %u bytes: %s\n", topicJson.c_str(), jsonString.length(),
-                         jsonString.c_str());
-                publish(topicJson.c_str(), jsonString.c_str(), false);
+    size_t numPublished =
+        spool.drain(MQTT_SPOOL_BATCH, [this](const char *topic, const uint8_t *payload, size_t length, bool isText) {
+            if (isText) {
+                std::string text((const char *)payload, length);
+                return publish(topic, text.c_str(), false);
             }
-        }
-#endif // ARCH_NRF52
-        mqttPool.release(env);
-    }
+            return publish(topic, payload, length, false);
+        });
+    if (numPublished)
+        LOG_INFO("Published %u spooled MQTT messages\n", numPublished);
 }
 
 void MQTT::onSend(const meshtastic_MeshPacket &mp, const meshtastic_MeshPacket &mp_decoded, ChannelIndex chIndex)
@@ -510,41 +504,40 @@ void MQTT::onSend(const meshtastic_MeshPacket &mp, const meshtastic_MeshPacket &
             LOG_DEBUG("portnum %i message\n", env->packet->decoded.portnum);
         }
 
-        if (moduleConfig.mqtt.proxy_to_client_enabled || this->isConnectedDirectly()) {
-            // FIXME - this size calculation is super sloppy, but it will go away once we dynamically alloc meshpackets
-            static uint8_t bytes[meshtastic_MeshPacket_size + 64];
-            size_t numBytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_ServiceEnvelope_msg, env);
+        // FIXME - this size calculation is super sloppy, but it will go away once we dynamically alloc meshpackets
+        static uint8_t bytes[meshtastic_MeshPacket_size + 64];
+        size_t numBytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_ServiceEnvelope_msg, env);
+        mqttPool.release(env);
+
+        std::string topic = cryptTopic + channelId + "/" + owner.id;
+        static char jsonString[MQTT_JSON_BUFFER_SIZE];
+        size_t jsonLength = 0;
+        std::string topicJson;
+#ifndef ARCH_NRF52 // JSON is not supported on nRF52, see issue #2804
+        if (moduleConfig.mqtt.json_enabled) {
+            // handle json topic
+            jsonLength = this->meshPacketToJson((meshtastic_MeshPacket *)&mp_decoded, jsonString, sizeof(jsonString));
+            topicJson = jsonTopic + channelId + "/" + owner.id;
+        }
+#endif // ARCH_NRF52
 
-            std::string topic = cryptTopic + channelId + "/" + owner.id;
+        // Anything still spooled goes first, so the broker sees packets in the order we heard them
+        if ((moduleConfig.mqtt.proxy_to_client_enabled || this->isConnectedDirectly()) && spool.isEmpty()) {
             LOG_DEBUG("MQTT Publish %s, %u bytes\n", topic.c_str(), numBytes);
 
             publish(topic.c_str(), bytes, numBytes, false);
 
-#ifndef ARCH_NRF52 // JSON is not supported on nRF52, see issue #2804
-            if (moduleConfig.mqtt.json_enabled) {
-                // handle json topic
-                auto jsonString = this->meshPacketToJson((meshtastic_MeshPacket *)&mp_decoded);
-                if (jsonString.length() != 0) {
-                    std::string topicJson = jsonTopic + channelId + "/" + owner.id;
-                    LOG_INFO("JSON publish message to %s, %u bytes: %s\n", topicJson.c_str(), jsonString.length(),
-                             jsonString.c_str());
-                    publish(topicJson.c_str(), jsonString.c_str(), false);
-                }
+            if (jsonLength != 0) {
+                LOG_INFO("JSON publish message to %s, %u bytes: %s\n", topicJson.c_str(), jsonLength, jsonString);
+                publish(topicJson.c_str(), jsonString, false);
             }
-#endif // ARCH_NRF52
         } else {
-            LOG_INFO("MQTT not connected, queueing packet\n");
-            if (mqttQueue.numFree() == 0) {
-                LOG_WARN("NOTE: MQTT queue is full, discarding oldest\n");
-                meshtastic_ServiceEnvelope *d = mqttQueue.dequeuePtr(0);
-                if (d)
-                    mqttPool.release(d);
-            }
-            // make a copy of serviceEnvelope and queue it
-            meshtastic_ServiceEnvelope *copied = mqttPool.allocCopy(*env);
-            assert(mqttQueue.enqueue(copied, 0));
+            // The packet is freed once we return, so spool the encoded envelope (not a pointer to it)
+            LOG_INFO("MQTT not connected, spooling packet\n");
+            spool.push(topic.c_str(), bytes, numBytes, false);
+            if (jsonLength != 0)
+                spool.push(topicJson.c_str(), (const uint8_t *)jsonString, jsonLength, true);
         }
-        mqttPool.release(env);
     }
 }
 
@@ -625,15 +618,22 @@ void MQTT::perhapsReportToMap()
 }
 
 // converts a downstream packet into a json message
-std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
+size_t MQTT::meshPacketToJson(meshtastic_MeshPacket *mp, char *json, size_t jsonSize)
 {
-    // the created jsonObj is immutable after creation, so
-    // we need to do the heavy lifting before assembling it.
-    std::string msgType;
-    JSONObject jsonObj;
+    // We write members in sorted key order, which is how the std::map based JSONObject we used to build this ordered them
+    JsonWriter jw(json, jsonSize);
+    const char *msgType = "";
+
+    jw.beginObject();
+    jw.add("channel", (unsigned int)mp->channel);
+    jw.add("from", (unsigned int)mp->from);
+    if (mp->hop_start != 0 && mp->hop_limit <= mp->hop_start) {
+        jw.add("hop_start", (unsigned int)(mp->hop_start));
+        jw.add("hops_away", (unsigned int)(mp->hop_start - mp->hop_limit));
+    }
+    jw.add("id", (unsigned int)mp->id);
 
     if (mp->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
-        JSONObject msgPayload;
         switch (mp->decoded.portnum) {
         case meshtastic_PortNum_TEXT_MESSAGE_APP: {
             msgType = "text";
@@ -647,13 +647,15 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
             if (json_value != NULL) {
                 LOG_INFO("text message payload is of type json\n");
                 // if it is, then we can just use the json object
-                jsonObj["payload"] = json_value;
+                jw.addRaw("payload", json_value->Stringify().c_str());
+                delete json_value;
             } else {
                 // if it isn't, then we need to create a json object
                 // with the string as the value
                 LOG_INFO("text message payload is of type plaintext\n");
-                msgPayload["text"] = new JSONValue(payloadStr);
-                jsonObj["payload"] = new JSONValue(msgPayload);
+                jw.beginObject("payload");
+                jw.add("text", payloadStr);
+                jw.endObject();
             }
             break;
         }
@@ -662,35 +664,36 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
             meshtastic_Telemetry scratch;
             meshtastic_Telemetry *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Telemetry_msg, &scratch)) {
+            if (payloadCache.decode(*mp, &meshtastic_Telemetry_msg, &scratch, sizeof(scratch))) {
                 decoded = &scratch;
+                jw.beginObject("payload");
                 if (decoded->which_variant == meshtastic_Telemetry_device_metrics_tag) {
-                    msgPayload["battery_level"] = new JSONValue((unsigned int)decoded->variant.device_metrics.battery_level);
-                    msgPayload["voltage"] = new JSONValue(decoded->variant.device_metrics.voltage);
-                    msgPayload["channel_utilization"] = new JSONValue(decoded->variant.device_metrics.channel_utilization);
-                    msgPayload["air_util_tx"] = new JSONValue(decoded->variant.device_metrics.air_util_tx);
-                    msgPayload["uptime_seconds"] = new JSONValue((unsigned int)decoded->variant.device_metrics.uptime_seconds);
+                    jw.add("air_util_tx", decoded->variant.device_metrics.air_util_tx);
+                    jw.add("battery_level", (unsigned int)decoded->variant.device_metrics.battery_level);
+                    jw.add("channel_utilization", decoded->variant.device_metrics.channel_utilization);
+                    jw.add("uptime_seconds", (unsigned int)decoded->variant.device_metrics.uptime_seconds);
+                    jw.add("voltage", decoded->variant.device_metrics.voltage);
                 } else if (decoded->which_variant == meshtastic_Telemetry_environment_metrics_tag) {
-                    msgPayload["temperature"] = new JSONValue(decoded->variant.environment_metrics.temperature);
-                    msgPayload["relative_humidity"] = new JSONValue(decoded->variant.environment_metrics.relative_humidity);
-                    msgPayload["barometric_pressure"] = new JSONValue(decoded->variant.environment_metrics.barometric_pressure);
-                    msgPayload["gas_resistance"] = new JSONValue(decoded->variant.environment_metrics.gas_resistance);
-                    msgPayload["voltage"] = new JSONValue(decoded->variant.environment_metrics.voltage);
-                    msgPayload["current"] = new JSONValue(decoded->variant.environment_metrics.current);
-                    msgPayload["lux"] = new JSONValue(decoded->variant.environment_metrics.lux);
-                    msgPayload["white_lux"] = new JSONValue(decoded->variant.environment_metrics.white_lux);
-                    msgPayload["iaq"] = new JSONValue((uint)decoded->variant.environment_metrics.iaq);
-                    msgPayload["wind_speed"] = new JSONValue((uint)decoded->variant.environment_metrics.wind_speed);
-                    msgPayload["wind_direction"] = new JSONValue((uint)decoded->variant.environment_metrics.wind_direction);
+                    jw.add("barometric_pressure", decoded->variant.environment_metrics.barometric_pressure);
+                    jw.add("current", decoded->variant.environment_metrics.current);
+                    jw.add("gas_resistance", decoded->variant.environment_metrics.gas_resistance);
+                    jw.add("iaq", (uint)decoded->variant.environment_metrics.iaq);
+                    jw.add("lux", decoded->variant.environment_metrics.lux);
+                    jw.add("relative_humidity", decoded->variant.environment_metrics.relative_humidity);
+                    jw.add("temperature", decoded->variant.environment_metrics.temperature);
+                    jw.add("voltage", decoded->variant.environment_metrics.voltage);
+                    jw.add("white_lux", decoded->variant.environment_metrics.white_lux);
+                    jw.add("wind_direction", (uint)decoded->variant.environment_metrics.wind_direction);
+                    jw.add("wind_speed", (uint)decoded->variant.environment_metrics.wind_speed);
                 } else if (decoded->which_variant == meshtastic_Telemetry_power_metrics_tag) {
-                    msgPayload["voltage_ch1"] = new JSONValue(decoded->variant.power_metrics.ch1_voltage);
-                    msgPayload["current_ch1"] = new JSONValue(decoded->variant.power_metrics.ch1_current);
-                    msgPayload["voltage_ch2"] = new JSONValue(decoded->variant.power_metrics.ch2_voltage);
-                    msgPayload["current_ch2"] = new JSONValue(decoded->variant.power_metrics.ch2_current);
-                    msgPayload["voltage_ch3"] = new JSONValue(decoded->variant.power_metrics.ch3_voltage);
-                    msgPayload["current_ch3"] = new JSONValue(decoded->variant.power_metrics.ch3_current);
+                    jw.add("current_ch1", decoded->variant.power_metrics.ch1_current);
+                    jw.add("current_ch2", decoded->variant.power_metrics.ch2_current);
+                    jw.add("current_ch3", decoded->variant.power_metrics.ch3_current);
+                    jw.add("voltage_ch1", decoded->variant.power_metrics.ch1_voltage);
+                    jw.add("voltage_ch2", decoded->variant.power_metrics.ch2_voltage);
+                    jw.add("voltage_ch3", decoded->variant.power_metrics.ch3_voltage);
                 }
-                jsonObj["payload"] = new JSONValue(msgPayload);
+                jw.endObject();
             } else {
                 LOG_ERROR("Error decoding protobuf for telemetry message!\n");
             }
@@ -701,13 +704,14 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
             meshtastic_User scratch;
             meshtastic_User *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_User_msg, &scratch)) {
+            if (payloadCache.decode(*mp, &meshtastic_User_msg, &scratch, sizeof(scratch))) {
                 decoded = &scratch;
-                msgPayload["id"] = new JSONValue(decoded->id);
-                msgPayload["longname"] = new JSONValue(decoded->long_name);
-                msgPayload["shortname"] = new JSONValue(decoded->short_name);
-                msgPayload["hardware"] = new JSONValue(decoded->hw_model);
-                jsonObj["payload"] = new JSONValue(msgPayload);
+                jw.beginObject("payload");
+                jw.add("hardware", (int)decoded->hw_model);
+                jw.add("id", decoded->id);
+                jw.add("longname", decoded->long_name);
+                jw.add("shortname", decoded->short_name);
+                jw.endObject();
             } else {
                 LOG_ERROR("Error decoding protobuf for nodeinfo message!\n");
             }
@@ -718,41 +722,42 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
             meshtastic_Position scratch;
             meshtastic_Position *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Position_msg, &scratch)) {
+            if (payloadCache.decode(*mp, &meshtastic_Position_msg, &scratch, sizeof(scratch))) {
                 decoded = &scratch;
-                if ((int)decoded->time) {
-                    msgPayload["time"] = new JSONValue((unsigned int)decoded->time);
+                jw.beginObject("payload");
+                if ((int)decoded->HDOP) {
+                    jw.add("HDOP", (int)decoded->HDOP);
                 }
-                if ((int)decoded->timestamp) {
-                    msgPayload["timestamp"] = new JSONValue((unsigned int)decoded->timestamp);
+                if ((int)decoded->PDOP) {
+                    jw.add("PDOP", (int)decoded->PDOP);
+                }
+                if ((int)decoded->VDOP) {
+                    jw.add("VDOP", (int)decoded->VDOP);
                 }
-                msgPayload["latitude_i"] = new JSONValue((int)decoded->latitude_i);
-                msgPayload["longitude_i"] = new JSONValue((int)decoded->longitude_i);
                 if ((int)decoded->altitude) {
-                    msgPayload["altitude"] = new JSONValue((int)decoded->altitude);
+                    jw.add("altitude", (int)decoded->altitude);
                 }
                 if ((int)decoded->ground_speed) {
-                    msgPayload["ground_speed"] = new JSONValue((unsigned int)decoded->ground_speed);
+                    jw.add("ground_speed", (unsigned int)decoded->ground_speed);
                 }
                 if (int(decoded->ground_track)) {
-                    msgPayload["ground_track"] = new JSONValue((unsigned int)decoded->ground_track);
+                    jw.add("ground_track", (unsigned int)decoded->ground_track);
                 }
-                if (int(decoded->sats_in_view)) {
-                    msgPayload["sats_in_view"] = new JSONValue((unsigned int)decoded->sats_in_view);
-                }
-                if ((int)decoded->PDOP) {
-                    msgPayload["PDOP"] = new JSONValue((int)decoded->PDOP);
+                jw.add("latitude_i", (int)decoded->latitude_i);
+                jw.add("longitude_i", (int)decoded->longitude_i);
+                if ((int)decoded->precision_bits) {
+                    jw.add("precision_bits", (int)decoded->precision_bits);
                 }
-                if ((int)decoded->HDOP) {
-                    msgPayload["HDOP"] = new JSONValue((int)decoded->HDOP);
+                if (int(decoded->sats_in_view)) {
+                    jw.add("sats_in_view", (unsigned int)decoded->sats_in_view);
                 }
-                if ((int)decoded->VDOP) {
-                    msgPayload["VDOP"] = new JSONValue((int)decoded->VDOP);
+                if ((int)decoded->time) {
+                    jw.add("time", (unsigned int)decoded->time);
                 }
-                if ((int)decoded->precision_bits) {
-                    msgPayload["precision_bits"] = new JSONValue((int)decoded->precision_bits);
+                if ((int)decoded->timestamp) {
+                    jw.add("timestamp", (unsigned int)decoded->timestamp);
                 }
-                jsonObj["payload"] = new JSONValue(msgPayload);
+                jw.endObject();
             } else {
                 LOG_ERROR("Error decoding protobuf for position message!\n");
             }
@@ -763,16 +768,17 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
             meshtastic_Waypoint scratch;
             meshtastic_Waypoint *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Waypoint_msg, &scratch)) {
+            if (payloadCache.decode(*mp, &meshtastic_Waypoint_msg, &scratch, sizeof(scratch))) {
                 decoded = &scratch;
-                msgPayload["id"] = new JSONValue((unsigned int)decoded->id);
-                msgPayload["name"] = new JSONValue(decoded->name);
-                msgPayload["description"] = new JSONValue(decoded->description);
-                msgPayload["expire"] = new JSONValue((unsigned int)decoded->expire);
-                msgPayload["locked_to"] = new JSONValue((unsigned int)decoded->locked_to);
-                msgPayload["latitude_i"] = new JSONValue((int)decoded->latitude_i);
-                msgPayload["longitude_i"] = new JSONValue((int)decoded->longitude_i);
-                jsonObj["payload"] = new JSONValue(msgPayload);
+                jw.beginObject("payload");
+                jw.add("description", decoded->description);
+                jw.add("expire", (unsigned int)decoded->expire);
+                jw.add("id", (unsigned int)decoded->id);
+                jw.add("latitude_i", (int)decoded->latitude_i);
+                jw.add("locked_to", (unsigned int)decoded->locked_to);
+                jw.add("longitude_i", (int)decoded->longitude_i);
+                jw.add("name", decoded->name);
+                jw.endObject();
             } else {
                 LOG_ERROR("Error decoding protobuf for position message!\n");
             }
@@ -783,22 +789,22 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
             meshtastic_NeighborInfo scratch;
             meshtastic_NeighborInfo *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_NeighborInfo_msg,
-                                     &scratch)) {
+            if (payloadCache.decode(*mp, &meshtastic_NeighborInfo_msg, &scratch, sizeof(scratch))) {
                 decoded = &scratch;
-                msgPayload["node_id"] = new JSONValue((unsigned int)decoded->node_id);
-                msgPayload["node_broadcast_interval_secs"] = new JSONValue((unsigned int)decoded->node_broadcast_interval_secs);
-                msgPayload["last_sent_by_id"] = new JSONValue((unsigned int)decoded->last_sent_by_id);
-                msgPayload["neighbors_count"] = new JSONValue(decoded->neighbors_count);
-                JSONArray neighbors;
+                jw.beginObject("payload");
+                jw.add("last_sent_by_id", (unsigned int)decoded->last_sent_by_id);
+                jw.beginArray("neighbors");
                 for (uint8_t i = 0; i < decoded->neighbors_count; i++) {
-                    JSONObject neighborObj;
-                    neighborObj["node_id"] = new JSONValue((unsigned int)decoded->neighbors[i].node_id);
-                    neighborObj["snr"] = new JSONValue((int)decoded->neighbors[i].snr);
-                    neighbors.push_back(new JSONValue(neighborObj));
+                    jw.beginObject();
+                    jw.add("node_id", (unsigned int)decoded->neighbors[i].node_id);
+                    jw.add("snr", (int)decoded->neighbors[i].snr);
+                    jw.endObject();
                 }
-                msgPayload["neighbors"] = new JSONValue(neighbors);
-                jsonObj["payload"] = new JSONValue(msgPayload);
+                jw.endArray();
+                jw.add("neighbors_count", (int)decoded->neighbors_count);
+                jw.add("node_broadcast_interval_secs", (unsigned int)decoded->node_broadcast_interval_secs);
+                jw.add("node_id", (unsigned int)decoded->node_id);
+                jw.endObject();
             } else {
                 LOG_ERROR("Error decoding protobuf for neighborinfo message!\n");
             }
@@ -810,27 +816,23 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
                 meshtastic_RouteDiscovery scratch;
                 meshtastic_RouteDiscovery *decoded = NULL;
                 memset(&scratch, 0, sizeof(scratch));
-                if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_RouteDiscovery_msg,
-                                         &scratch)) {
+                if (payloadCache.decode(*mp, &meshtastic_RouteDiscovery_msg, &scratch, sizeof(scratch))) {
                     decoded = &scratch;
-                    JSONArray route; // Route this message took
                     // Lambda function for adding a long name to the route
-                    auto addToRoute = [](JSONArray *route, NodeNum num) {
-                        char long_name[40] = "Unknown";
+                    auto addToRoute = [&jw](NodeNum num) {
                         meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(num);
                         bool name_known = node ? node->has_user : false;
-                        if (name_known)
-                            memcpy(long_name, node->user.long_name, sizeof(long_name));
-                        route->push_back(new JSONValue(long_name));
+                        jw.add(NULL, name_known ? node->user.long_name : "Unknown");
                     };
-                    addToRoute(&route, mp->to); // Started at the original transmitter (destination of response)
+                    jw.beginObject("payload");
+                    jw.beginArray("route"); // Route this message took
+                    addToRoute(mp->to);     // Started at the original transmitter (destination of response)
                     for (uint8_t i = 0; i < decoded->route_count; i++) {
-                        addToRoute(&route, decoded->route[i]);
+                        addToRoute(decoded->route[i]);
                     }
-                    addToRoute(&route, mp->from); // Ended at the original destination (source of response)
-
-                    msgPayload["route"] = new JSONValue(route);
-                    jsonObj["payload"] = new JSONValue(msgPayload);
+                    addToRoute(mp->from); // Ended at the original destination (source of response)
+                    jw.endArray();
+                    jw.endObject();
                 } else {
                     LOG_ERROR("Error decoding protobuf for traceroute message!\n");
                 }
@@ -839,11 +841,10 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
         }
         case meshtastic_PortNum_DETECTION_SENSOR_APP: {
             msgType = "detection";
-            char payloadStr[(mp->decoded.payload.size) + 1];
-            memcpy(payloadStr, mp->decoded.payload.bytes, mp->decoded.payload.size);
-            payloadStr[mp->decoded.payload.size] = 0; // null terminated string
-            msgPayload["text"] = new JSONValue(payloadStr);
-            jsonObj["payload"] = new JSONValue(msgPayload);
+            jw.beginObject("payload");
+            const char *text = (const char *)mp->decoded.payload.bytes;
+            jw.add("text", text, strnlen(text, mp->decoded.payload.size)); // up to any nul, as the old C string copy did
+            jw.endObject();
             break;
         }
 #ifdef ARCH_ESP32
@@ -852,12 +853,13 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
             meshtastic_Paxcount scratch;
             meshtastic_Paxcount *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_Paxcount_msg, &scratch)) {
+            if (payloadCache.decode(*mp, &meshtastic_Paxcount_msg, &scratch, sizeof(scratch))) {
                 decoded = &scratch;
-                msgPayload["wifi_count"] = new JSONValue((unsigned int)decoded->wifi);
-                msgPayload["ble_count"] = new JSONValue((unsigned int)decoded->ble);
-                msgPayload["uptime"] = new JSONValue((unsigned int)decoded->uptime);
-                jsonObj["payload"] = new JSONValue(msgPayload);
+                jw.beginObject("payload");
+                jw.add("ble_count", (unsigned int)decoded->ble);
+                jw.add("uptime", (unsigned int)decoded->uptime);
+                jw.add("wifi_count", (unsigned int)decoded->wifi);
+                jw.endObject();
             } else {
                 LOG_ERROR("Error decoding protobuf for Paxcount message!\n");
             }
@@ -868,18 +870,19 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
             meshtastic_HardwareMessage scratch;
             meshtastic_HardwareMessage *decoded = NULL;
             memset(&scratch, 0, sizeof(scratch));
-            if (pb_decode_from_bytes(mp->decoded.payload.bytes, mp->decoded.payload.size, &meshtastic_HardwareMessage_msg,
-                                     &scratch)) {
+            if (payloadCache.decode(*mp, &meshtastic_HardwareMessage_msg, &scratch, sizeof(scratch))) {
                 decoded = &scratch;
                 if (decoded->type == meshtastic_HardwareMessage_Type_GPIOS_CHANGED) {
                     msgType = "gpios_changed";
-                    msgPayload["gpio_value"] = new JSONValue((unsigned int)decoded->gpio_value);
-                    jsonObj["payload"] = new JSONValue(msgPayload);
+                    jw.beginObject("payload");
+                    jw.add("gpio_value", (unsigned int)decoded->gpio_value);
+                    jw.endObject();
                 } else if (decoded->type == meshtastic_HardwareMessage_Type_READ_GPIOS_REPLY) {
                     msgType = "gpios_read_reply";
-                    msgPayload["gpio_value"] = new JSONValue((unsigned int)decoded->gpio_value);
-                    msgPayload["gpio_mask"] = new JSONValue((unsigned int)decoded->gpio_mask);
-                    jsonObj["payload"] = new JSONValue(msgPayload);
+                    jw.beginObject("payload");
+                    jw.add("gpio_mask", (unsigned int)decoded->gpio_mask);
+                    jw.add("gpio_value", (unsigned int)decoded->gpio_value);
+                    jw.endObject();
                 }
             } else {
                 LOG_ERROR("Error decoding protobuf for RemoteHardware message!\n");
@@ -894,30 +897,23 @@ std::string MQTT::meshPacketToJson(meshtastic_MeshPacket *mp)
         LOG_WARN("Couldn't convert encrypted payload of MeshPacket to JSON\n");
     }
 
-    jsonObj["id"] = new JSONValue((unsigned int)mp->id);
-    jsonObj["timestamp"] = new JSONValue((unsigned int)mp->rx_time);
-    jsonObj["to"] = new JSONValue((unsigned int)mp->to);
-    jsonObj["from"] = new JSONValue((unsigned int)mp->from);
-    jsonObj["channel"] = new JSONValue((unsigned int)mp->channel);
-    jsonObj["type"] = new JSONValue(msgType.c_str());
-    jsonObj["sender"] = new JSONValue(owner.id);
     if (mp->rx_rssi != 0)
-        jsonObj["rssi"] = new JSONValue((int)mp->rx_rssi);
+        jw.add("rssi", (int)mp->rx_rssi);
+    jw.add("sender", owner.id);
     if (mp->rx_snr != 0)
-        jsonObj["snr"] = new JSONValue((float)mp->rx_snr);
-    if (mp->hop_start != 0 && mp->hop_limit <= mp->hop_start) {
-        jsonObj["hops_away"] = new JSONValue((unsigned int)(mp->hop_start - mp->hop_limit));
-        jsonObj["hop_start"] = new JSONValue((unsigned int)(mp->hop_start));
+        jw.add("snr", (float)mp->rx_snr);
+    jw.add("timestamp", (unsigned int)mp->rx_time);
+    jw.add("to", (unsigned int)mp->to);
+    jw.add("type", msgType);
+    jw.endObject();
+
+    if (jw.overflowed()) {
+        LOG_ERROR("JSON for packet 0x%x doesn't fit in %u bytes\n", mp->id, jsonSize);
+        return 0;
     }
 
-    // serialize and write it to the stream
-    JSONValue *value = new JSONValue(jsonObj);
-    std::string jsonStr = value->Stringify();
-
-    LOG_INFO("serialized json message: %s\n", jsonStr.c_str());
-
-    delete value;
-    return jsonStr;
+    LOG_INFO("serialized json message: %s\n", json);
+    return jw.length();
 }
 
 bool MQTT::isValidJsonEnvelope(JSONObject &json)
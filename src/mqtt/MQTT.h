@@ -6,6 +6,12 @@
 #include "mesh/Channels.h"
 #include "mesh/generated/meshtastic/mqtt.pb.h"
 #include "mqtt/JSON.h"
+#include "mqtt/MqttSpool.h"
+
+/// The largest JSON message we will publish for a packet
+#ifndef MQTT_JSON_BUFFER_SIZE
+#define MQTT_JSON_BUFFER_SIZE 2048
+#endif
 #if HAS_WIFI
 #include <WiFiClient.h>
 #if !defined(ARCH_PORTDUINO)
@@ -20,8 +26,6 @@
 #include <PubSubClient.h>
 #endif
 
-#define MAX_MQTT_QUEUE 16
-
 /**
  * Our wrapper/singleton for sending/receiving MQTT "udp" packets.  This object isolates the MQTT protocol implementation from
  * the two components that use it: MQTTPlugin and MQTTSimInterface.
@@ -74,7 +78,10 @@ class MQTT : private concurrency::OSThread
     void start() { setIntervalFromNow(0); };
 
   protected:
-    PointerQueue<meshtastic_ServiceEnvelope> mqttQueue;
+    /// Messages waiting for the broker to come back
+    MqttSpool spool;
+
+    uint32_t lastSpoolDrain = 0;
 
     int reconnectCount = 0;
 
@@ -107,8 +114,12 @@ class MQTT : private concurrency::OSThread
     /// Called when a new publish arrives from the MQTT server
     void onReceive(char *topic, byte *payload, size_t length);
 
-    /// Called when a new publish arrives from the MQTT server
-    std::string meshPacketToJson(meshtastic_MeshPacket *mp);
+    /**
+     * Write the JSON for mp into json
+     *
+     * @return the length of the JSON, or 0 if it didn't fit in jsonSize bytes
+     */
+    size_t meshPacketToJson(meshtastic_MeshPacket *mp, char *json, size_t jsonSize);
 
     void publishStatus();
     void publishQueuedMessages();
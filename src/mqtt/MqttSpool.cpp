@@ -0,0 +1,313 @@
+#include "MqttSpool.h"
+#include "FSCommon.h"
+#include <vector>
+
+static const char *cursorFileName = "/prefs/mqtt_spool.pos";
+
+/// Every record starts with one of these, followed by the topic and then the payload
+struct __attribute__((packed)) SpoolRecordHeader {
+    uint8_t isText;
+    uint8_t topicLen;
+    uint16_t payloadLen;
+};
+
+/// Each segment file starts with its sequence number
+static const uint32_t segmentHeaderSize = sizeof(uint32_t);
+
+void MqttSpool::getSlotFileName(char *name, size_t nameLen, int slot)
+{
+    snprintf(name, nameLen, "/prefs/mqtt_spool%d", slot);
+}
+
+int MqttSpool::findSlot(uint32_t seq) const
+{
+    for (int i = 0; i < MQTT_SPOOL_SEGMENTS; i++)
+        if (slotSeq[i] == seq)
+            return i;
+    return -1;
+}
+
+void MqttSpool::begin()
+{
+#ifdef FSCom
+    char name[32];
+    readSeq = writeSeq = 0;
+    for (int i = 0; i < MQTT_SPOOL_SEGMENTS; i++) {
+        slotSeq[i] = slotSize[i] = 0;
+        getSlotFileName(name, sizeof(name), i);
+        if (!FSCom.exists(name))
+            continue;
+
+        auto f = FSCom.open(name, FILE_O_READ);
+        uint32_t seq = 0;
+        if (f && f.read((uint8_t *)&seq, sizeof(seq)) == sizeof(seq) && seq) {
+            slotSeq[i] = seq;
+            slotSize[i] = f.size();
+            if (!readSeq || seq < readSeq)
+                readSeq = seq;
+            if (seq > writeSeq)
+                writeSeq = seq;
+        }
+        if (f)
+            f.close();
+        if (!slotSeq[i]) {
+            LOG_WARN("Removing unreadable MQTT spool segment %s\n", name);
+            FSCom.remove(name);
+        }
+    }
+
+    if (!readSeq) {
+        if (FSCom.exists(cursorFileName))
+            FSCom.remove(cursorFileName);
+        return;
+    }
+
+    // Pick up where we left off publishing the oldest segment
+    readOffset = segmentHeaderSize;
+    Cursor cursor = {};
+    auto f = FSCom.open(cursorFileName, FILE_O_READ);
+    if (f) {
+        if (f.read((uint8_t *)&cursor, sizeof(cursor)) == sizeof(cursor) && cursor.seq == readSeq &&
+            cursor.offset >= segmentHeaderSize && cursor.offset <= slotSize[findSlot(readSeq)])
+            readOffset = cursor.offset;
+        f.close();
+    }
+
+    // The last record of the newest segment might be torn, anything appended after it would be lost, so start a fresh one
+    slotSize[findSlot(writeSeq)] = MQTT_SPOOL_SEGMENT_SIZE;
+
+    LOG_INFO("MQTT spool has %u pending segments\n", writeSeq - readSeq + 1);
+#endif
+}
+
+#ifdef ARCH_NRF52
+static int countBlock(void *numBlocks, lfs_block_t block)
+{
+    (*(uint32_t *)numBlocks)++;
+    return 0;
+}
+#endif
+
+bool MqttSpool::haveRoomForSegment()
+{
+    uint32_t needed = MQTT_SPOOL_SEGMENT_SIZE + MQTT_SPOOL_FS_RESERVE;
+#if defined(ARCH_ESP32)
+    return FSCom.totalBytes() - FSCom.usedBytes() >= needed;
+#elif defined(ARCH_RP2040)
+    FSInfo info;
+    return FSCom.info(info) && info.totalBytes - info.usedBytes >= needed;
+#elif defined(ARCH_NRF52)
+    // Adafruit's LittleFS can't tell us how full it is, so count the blocks in use ourselves.  Other tasks (i.e. Bluefruit
+    // saving bonds) write to it too, so hold its lock like its own methods do
+    lfs_t *lfs = FSCom._getFS();
+    uint32_t numUsed = 0;
+    FSCom._lockFS();
+    int err = lfs_traverse(lfs, countBlock, &numUsed);
+    FSCom._unlockFS();
+    if (err < 0 || numUsed > lfs->cfg->block_count)
+        return false;
+    return (lfs->cfg->block_count - numUsed) * lfs->cfg->block_size >= needed;
+#else
+    return true; // No way to ask, a failed write will tell us
+#endif
+}
+
+bool MqttSpool::startSegment()
+{
+#ifdef FSCom
+    int slot = findSlot(0);
+    if (slot < 0) {
+        LOG_WARN("MQTT spool is full, discarding oldest messages\n");
+        numDroppedSegments++;
+        dropOldest();
+        slot = findSlot(0);
+    }
+
+    // The rest of the firmware needs the filesystem more than we do, make room by giving up our oldest messages
+    while (!haveRoomForSegment()) {
+        if (!readSeq) {
+            LOG_WARN("Not enough filesystem space to spool MQTT messages\n");
+            return false;
+        }
+        LOG_WARN("Filesystem is short of space, discarding oldest MQTT spool messages\n");
+        numDroppedSegments++;
+        dropOldest();
+    }
+
+    char name[32];
+    getSlotFileName(name, sizeof(name), slot);
+    uint32_t seq = writeSeq + 1;
+
+    FSCom.mkdir("/prefs");
+    auto f = FSCom.open(name, FILE_O_WRITE);
+    if (!f) {
+        LOG_ERROR("Can't create %s\n", name);
+        return false;
+    }
+    bool okay = f.write((const uint8_t *)&seq, sizeof(seq)) == sizeof(seq);
+    f.flush();
+    f.close();
+    if (!okay) {
+        LOG_ERROR("Can't write %s\n", name);
+        FSCom.remove(name);
+        return false;
+    }
+
+    slotSeq[slot] = writeSeq = seq;
+    slotSize[slot] = segmentHeaderSize;
+    if (!readSeq) {
+        readSeq = seq;
+        readOffset = segmentHeaderSize;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MqttSpool::dropOldest()
+{
+#ifdef FSCom
+    int slot = findSlot(readSeq);
+    if (slot >= 0) {
+        char name[32];
+        getSlotFileName(name, sizeof(name), slot);
+        if (!FSCom.remove(name))
+            LOG_WARN("Can't remove %s\n", name);
+        slotSeq[slot] = slotSize[slot] = 0;
+    }
+
+    readSeq = 0;
+    for (int i = 0; i < MQTT_SPOOL_SEGMENTS; i++)
+        if (slotSeq[i] && (!readSeq || slotSeq[i] < readSeq))
+            readSeq = slotSeq[i];
+    readOffset = segmentHeaderSize;
+
+    // A cursor left behind would only confuse us
+    if (!readSeq && FSCom.exists(cursorFileName))
+        FSCom.remove(cursorFileName);
+#endif
+}
+
+void MqttSpool::saveCursor()
+{
+#ifdef FSCom
+    Cursor cursor = {readSeq, readOffset};
+    auto f = FSCom.open(cursorFileName, FILE_O_WRITE);
+    if (f) {
+        f.write((const uint8_t *)&cursor, sizeof(cursor));
+        f.flush();
+        f.close();
+    } else {
+        LOG_WARN("Can't write %s\n", cursorFileName);
+    }
+#endif
+}
+
+bool MqttSpool::push(const char *topic, const uint8_t *payload, size_t length, bool isText)
+{
+#ifdef FSCom
+    size_t topicLen = strlen(topic);
+    size_t recordLen = sizeof(SpoolRecordHeader) + topicLen + length;
+    if (topicLen > MQTT_SPOOL_MAX_TOPIC || segmentHeaderSize + recordLen > MQTT_SPOOL_SEGMENT_SIZE) {
+        LOG_WARN("MQTT message for %s is too big to spool, %u bytes\n", topic, length);
+        return false;
+    }
+
+    for (int attempt = 0;; attempt++) {
+        int slot = findSlot(writeSeq);
+        if (!writeSeq || slot < 0 || slotSize[slot] + recordLen > MQTT_SPOOL_SEGMENT_SIZE) {
+            if (!startSegment())
+                return false;
+            slot = findSlot(writeSeq);
+        }
+
+        char name[32];
+        getSlotFileName(name, sizeof(name), slot);
+        auto f = FSCom.open(name, FILE_O_APPEND);
+        if (!f) {
+            LOG_ERROR("Can't open %s\n", name);
+            return false;
+        }
+
+        SpoolRecordHeader h = {isText, (uint8_t)topicLen, (uint16_t)length};
+        bool okay = f.write((const uint8_t *)&h, sizeof(h)) == sizeof(h) &&
+                    f.write((const uint8_t *)topic, topicLen) == topicLen && f.write(payload, length) == length;
+        f.flush();
+        f.close();
+
+        if (okay) {
+            slotSize[slot] += recordLen;
+            return true;
+        }
+
+        // We might have left part of a record behind, which ends this segment
+        LOG_ERROR("Can't append to %s\n", name);
+        slotSize[slot] = MQTT_SPOOL_SEGMENT_SIZE;
+
+        // Most likely the filesystem filled up, give up our oldest messages rather than this one and try a fresh segment
+        if (attempt > 0 || readSeq == writeSeq)
+            return false;
+        LOG_WARN("Discarding oldest MQTT spool messages to make room\n");
+        numDroppedSegments++;
+        dropOldest();
+    }
+#else
+    return false;
+#endif
+}
+
+size_t MqttSpool::drain(size_t maxMessages, PublishFn publish)
+{
+    size_t numPublished = 0;
+#ifdef FSCom
+    bool publishFailed = false;
+    while (readSeq && numPublished < maxMessages && !publishFailed) {
+        char name[32];
+        getSlotFileName(name, sizeof(name), findSlot(readSeq));
+
+        bool segmentDone = true; // if we can't read the segment there is no point in keeping it
+        auto f = FSCom.open(name, FILE_O_READ);
+        if (f && f.seek(readOffset)) {
+            char topic[MQTT_SPOOL_MAX_TOPIC + 1];
+            std::vector<uint8_t> payload;
+            SpoolRecordHeader h;
+
+            while (true) {
+                if (numPublished >= maxMessages) {
+                    segmentDone = false;
+                    break;
+                }
+
+                // The end of the segment, or a record torn by a power loss
+                if (f.read((uint8_t *)&h, sizeof(h)) != sizeof(h) || h.topicLen > MQTT_SPOOL_MAX_TOPIC ||
+                    f.read((uint8_t *)topic, h.topicLen) != h.topicLen)
+                    break;
+                topic[h.topicLen] = '\0';
+                payload.resize(h.payloadLen);
+                if (h.payloadLen && f.read(payload.data(), h.payloadLen) != h.payloadLen)
+                    break;
+
+                if (!publish(topic, payload.data(), h.payloadLen, h.isText)) {
+                    segmentDone = false;
+                    publishFailed = true;
+                    break;
+                }
+                readOffset += sizeof(h) + h.topicLen + h.payloadLen;
+                numPublished++;
+            }
+        }
+        if (f)
+            f.close();
+
+        if (segmentDone) {
+            LOG_DEBUG("Finished publishing MQTT spool segment %u\n", readSeq);
+            dropOldest();
+        }
+    }
+
+    if (readSeq && numPublished)
+        saveCursor();
+#endif
+    return numPublished;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "configuration.h"
+#include <functional>
+
+/// How many segment files the spool may use, once they are all full the oldest one is dropped to make room
+#ifndef MQTT_SPOOL_SEGMENTS
+#if defined(ARCH_NRF52) || defined(ARCH_RP2040)
+#define MQTT_SPOOL_SEGMENTS 2
+#else
+#define MQTT_SPOOL_SEGMENTS 4
+#endif
+#endif
+
+/// The most bytes of messages we keep in each segment file
+#ifndef MQTT_SPOOL_SEGMENT_SIZE
+#if defined(ARCH_NRF52)
+#define MQTT_SPOOL_SEGMENT_SIZE (2 * 1024) // InternalFS is only 28KB, and the node database needs most of it
+#elif defined(ARCH_RP2040)
+#define MQTT_SPOOL_SEGMENT_SIZE (4 * 1024)
+#else
+#define MQTT_SPOOL_SEGMENT_SIZE (8 * 1024)
+#endif
+#endif
+
+/// Free filesystem space (in bytes) we always leave for everything else, a new segment is only started if it fits on top
+#ifndef MQTT_SPOOL_FS_RESERVE
+#if defined(ARCH_NRF52)
+#define MQTT_SPOOL_FS_RESERVE (12 * 1024)
+#else
+#define MQTT_SPOOL_FS_RESERVE (32 * 1024)
+#endif
+#endif
+
+/// The most messages we publish from the spool each time the MQTT thread drains it
+#ifndef MQTT_SPOOL_BATCH
+#define MQTT_SPOOL_BATCH 8
+#endif
+
+/// The least time (in msecs) between draining batches, so catching up after an outage doesn't starve live traffic
+#ifndef MQTT_SPOOL_DRAIN_INTERVAL
+#define MQTT_SPOOL_DRAIN_INTERVAL 250
+#endif
+
+/// The longest topic we will spool a message for
+#define MQTT_SPOOL_MAX_TOPIC 128
+
+/**
+ * A file backed FIFO of ready to publish MQTT messages (topic + already encoded payload), for when the broker is unreachable.
+ * isText marks payloads (i.e. JSON) that must be published as text when we proxy through the phone.
+ *
+ * Messages are appended to the newest of up to MQTT_SPOOL_SEGMENTS segment files.  Each segment starts with its sequence number
+ * so at boot we can put them back in order.  A small cursor file remembers how far into the oldest segment we have published,
+ * it is rewritten once per drained batch.  A segment is deleted once everything in it is published, or (losing what was left
+ * in it) when we need its slot or its filesystem space for newer messages.
+ *
+ * A record torn by a power loss ends its segment, everything before it is still published.
+ */
+class MqttSpool
+{
+  public:
+    /// Publishes one message, returning false if it couldn't (i.e. we lost the broker again)
+    typedef std::function<bool(const char *topic, const uint8_t *payload, size_t length, bool isText)> PublishFn;
+
+    /// Find the segments left over from before we rebooted
+    void begin();
+
+    /**
+     * Append a message to the spool, dropping the oldest segment if we are out of room
+     *
+     * @return false if the message couldn't be written
+     */
+    bool push(const char *topic, const uint8_t *payload, size_t length, bool isText);
+
+    /**
+     * Publish up to maxMessages of the oldest spooled messages, stopping early if publish fails
+     *
+     * @return the number of messages that were published
+     */
+    size_t drain(size_t maxMessages, PublishFn publish);
+
+    /// @return true if there is nothing waiting to be published
+    bool isEmpty() const { return readSeq == 0; }
+
+    /// Number of segments we had to drop (unpublished) because the spool or the filesystem was full
+    uint32_t getNumDroppedSegments() const { return numDroppedSegments; }
+
+  private:
+    struct Cursor {
+        uint32_t seq;    // the segment we are publishing from
+        uint32_t offset; // the position of the first record in it we haven't published yet
+    };
+
+    /// Sequence number of the segment in each slot, or 0 if the slot is free
+    uint32_t slotSeq[MQTT_SPOOL_SEGMENTS] = {};
+
+    /// Size in bytes of the segment in each slot
+    uint32_t slotSize[MQTT_SPOOL_SEGMENTS] = {};
+
+    uint32_t readSeq = 0; // the oldest segment, or 0 if the spool is empty
+    uint32_t readOffset = 0;
+    uint32_t writeSeq = 0; // the newest segment, or 0 if the spool is empty
+
+    uint32_t numDroppedSegments = 0;
+
+    static void getSlotFileName(char *name, size_t nameLen, int slot);
+
+    int findSlot(uint32_t seq) const;
+
+    /// @return true if the filesystem can take another segment and still have MQTT_SPOOL_FS_RESERVE bytes free
+    static bool haveRoomForSegment();
+
+    /// Start a new newest segment, dropping the oldest ones if every slot is in use or the filesystem is short of space
+    bool startSegment();
+
+    /// Delete the oldest segment and move on to the next one
+    void dropOldest();
+
+    void saveCursor();
+};
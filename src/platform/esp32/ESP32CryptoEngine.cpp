@@ -8,6 +8,24 @@ class ESP32CryptoEngine : public CryptoEngine
 
     mbedtls_aes_context aes;
 
+    /// A key with its mbedtls key schedule already expanded
+    class ESP32PreparedKey : public PreparedKey
+    {
+      public:
+        mutable mbedtls_aes_context aes; // only read while crypting, mbedtls just doesn't declare it const
+
+        explicit ESP32PreparedKey(const CryptoKey &k) : PreparedKey(k)
+        {
+            mbedtls_aes_init(&aes);
+            if (key.length > 0) {
+                auto res = mbedtls_aes_setkey_enc(&aes, key.bytes, key.length * 8);
+                assert(!res);
+            }
+        }
+
+        ~ESP32PreparedKey() { mbedtls_aes_free(&aes); }
+    };
+
   public:
     ESP32CryptoEngine() { mbedtls_aes_init(&aes); }
 
@@ -64,6 +82,26 @@ class ESP32CryptoEngine : public CryptoEngine
         encrypt(fromNode, packetId, numBytes, bytes);
     }
 
+    virtual PreparedKey *prepareKey(const CryptoKey &k) override { return new ESP32PreparedKey(k); }
+
+    /**
+     * Reentrant encrypt, all per call state lives in ctx so both cores can use this at once (mbedtls arbitrates the AES
+     * peripheral itself)
+     */
+    virtual void encrypt(CryptoContext &ctx, const PreparedKey &k, uint32_t fromNode, uint64_t packetId, size_t numBytes,
+                         const uint8_t *in, uint8_t *out) override
+    {
+        if (k.key.length > 0) {
+            initNonce(ctx.nonce, fromNode, packetId);
+            size_t nc_off = 0;
+            auto res = mbedtls_aes_crypt_ctr(&static_cast<const ESP32PreparedKey &>(k).aes, numBytes, &nc_off, ctx.nonce,
+                                             ctx.streamBlock, in, out);
+            assert(!res);
+        } else if (out != in) {
+            memcpy(out, in, numBytes);
+        }
+    }
+
   private:
 };
 
@@ -10,6 +10,26 @@ class CrossPlatformCryptoEngine : public CryptoEngine
 
     CTRCommon *ctr = NULL;
 
+    /// A key with its AES key schedule already expanded
+    class AESPreparedKey : public PreparedKey
+    {
+      public:
+        BlockCipher *cipher = NULL;
+
+        explicit AESPreparedKey(const CryptoKey &k) : PreparedKey(k)
+        {
+            if (key.length == 16)
+                cipher = new AES128();
+            else if (key.length > 0)
+                cipher = new AES256();
+
+            if (cipher)
+                cipher->setKey(key.bytes, key.length);
+        }
+
+        ~AESPreparedKey() { delete cipher; }
+    };
+
   public:
     CrossPlatformCryptoEngine() {}
 
@@ -72,6 +92,26 @@ class CrossPlatformCryptoEngine : public CryptoEngine
         encrypt(fromNode, packetId, numBytes, bytes);
     }
 
+    virtual PreparedKey *prepareKey(const CryptoKey &k) override { return new AESPreparedKey(k); }
+
+    /**
+     * Reentrant encrypt, the expanded key is only read and all per call state lives in ctx, so any number of threads can
+     * use this at once
+     */
+    virtual void encrypt(CryptoContext &ctx, const PreparedKey &k, uint32_t fromNode, uint64_t packetId, size_t numBytes,
+                         const uint8_t *in, uint8_t *out) override
+    {
+        BlockCipher *cipher = static_cast<const AESPreparedKey &>(k).cipher;
+        if (cipher) {
+            initNonce(ctx.nonce, fromNode, packetId);
+            ctrCrypt(
+                ctx, [cipher](uint8_t *output, const uint8_t *input) { cipher->encryptBlock(output, input); }, numBytes, in,
+                out);
+        } else if (out != in) {
+            memcpy(out, in, numBytes);
+        }
+    }
+
   private:
 };
 
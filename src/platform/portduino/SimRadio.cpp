@@ -14,6 +14,7 @@ ErrorCode SimRadio::send(meshtastic_MeshPacket *p)
     printPacket("enqueuing for send", p);
 
     ErrorCode res = txQueue.enqueue(p) ? ERRNO_OK : ERRNO_UNKNOWN;
+    updateTxQueueDepth();
 
     if (res != ERRNO_OK) { // we weren't able to queue it, so we must drop it to prevent leaks
         packetPool.release(p);
@@ -121,12 +122,18 @@ bool SimRadio::isChannelActive()
     return false; // TODO ask simulator
 }
 
+void SimRadio::updateTxQueueDepth()
+{
+    routerStats.setTxQueueDepth(txQueue.getMaxLen() - txQueue.getFree());
+}
+
 /** Attempt to cancel a previously sent packet.  Returns true if a packet was found we could cancel */
 bool SimRadio::cancelSending(NodeNum from, PacketId id)
 {
     auto p = txQueue.remove(from, id);
     if (p)
         packetPool.release(p); // free the packet we just removed
+    updateTxQueueDepth();
 
     bool result = (p != NULL);
     LOG_DEBUG("cancelSending id=0x%x, removed=%d\n", id, result);
@@ -155,17 +162,21 @@ void SimRadio::onNotify(uint32_t notification)
                 // LOG_DEBUG("Currently Rx/Tx-ing: set random delay\n");
                 setTransmitDelay(); // currently Rx/Tx-ing: reset random delay
             } else {
-                if (isChannelActive()) { // check if there is currently a LoRa packet on the channel
+                bool channelActive = isChannelActive(); // check if there is currently a LoRa packet on the channel
+                txScheduler->onChannelChecked(channelActive);
+                if (channelActive) {
                     // LOG_DEBUG("Channel is active: set random delay\n");
                     setTransmitDelay(); // reset random delay
                 } else {
                     // Send any outgoing packets we have ready
                     meshtastic_MeshPacket *txp = txQueue.dequeue();
                     assert(txp);
+                    updateTxQueueDepth();
                     startSend(txp);
                     // Packet has been sent, count it toward our TX airtime utilization.
                     uint32_t xmitMsec = getPacketTime(txp);
                     airTime->logAirtime(TX_LOG, xmitMsec);
+                    txScheduler->onTransmit(txp);
 
                     notifyLater(xmitMsec, ISR_TX, false); // Model the time it is busy sending
                 }
@@ -18,6 +18,9 @@ class SimRadio : public RadioInterface, protected concurrency::NotifiedWorkerThr
 
     MeshPacketQueue txQueue = MeshPacketQueue(MAX_TX_QUEUE);
 
+    /// Tell routerStats how deep txQueue is, after anything that changes it
+    void updateTxQueueDepth();
+
   public:
     SimRadio();
 